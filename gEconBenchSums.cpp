@@ -0,0 +1,160 @@
+/*****************************************************************************
+ * This file is a part of gEcon.                                             *
+ *                                                                           *
+ * (c) Chancellery of the Prime Minister of the Republic of Poland 2012-2015 *
+ * (c) Grzegorz Klima, Karol Podemski, Kaja Retkiewicz-Wijtiwiak 2015-2016   *
+ * License terms can be found in the file 'LICENCE'                          *
+ *                                                                           *
+ * Author: Grzegorz Klima                                                    *
+ *****************************************************************************/
+
+/** \file gEconBenchSums.cpp
+ * \brief Benchmark: building large sums (heap allocations and time).
+ */
+
+#include <ex.h>
+#include <num_ex_pair_vec.h>
+#include <pool.h>
+#include <utils.h>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <iomanip>
+#include <new>
+#include <string>
+#include <vector>
+
+using symbolic::ex;
+using symbolic::Number;
+using symbolic::internal::node_pools;
+using symbolic::internal::num2str;
+using symbolic::internal::num_ex_pair;
+using symbolic::internal::num_ex_pair_vec_base;
+using symbolic::internal::ptr_base;
+
+
+namespace {
+
+// Heap allocations made through operator new
+unsigned long heap_allocs = 0;
+
+
+// Operand list of a sum extended by one term (copy of operands of the
+// previous sum, as in construction of an ADD node)
+template <typename V>
+V
+add_term(const V &ops, const num_ex_pair &t)
+{
+    V res;
+    res.reserve(ops.size() + 1);
+    for (typename V::const_iterator it = ops.begin(); it != ops.end(); ++it)
+        res.push_back(*it);
+    res.push_back(t);
+    return res;
+}
+
+
+// Build operand lists of sums term by term, returns time in ms
+template <typename V>
+double
+build_lists(const std::vector<ptr_base> &terms, unsigned n, unsigned reps,
+            unsigned long &allocs)
+{
+    allocs = heap_allocs;
+    std::clock_t start = std::clock();
+    for (unsigned r = 0; r < reps; ++r) {
+        V ops;
+        for (unsigned i = 0; i < n; ++i)
+            ops = add_term(ops, num_ex_pair(Number((double) (r + i + 1)), terms[i]));
+    }
+    allocs = heap_allocs - allocs;
+    return 1000. * (std::clock() - start) / CLOCKS_PER_SEC;
+}
+
+} /* namespace */
+
+
+void*
+operator new(std::size_t sz)
+{
+    ++heap_allocs;
+    void *p = std::malloc(sz ? sz : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+
+void
+operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+
+void
+operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+
+int main()
+{
+    // Number of terms, each sum is built term by term as parser and
+    // transformations do (every step creates a new ADD node)
+    const unsigned terms[] = { 2, 3, 4, 5, 8, 16, 64, 256, 1024 };
+    const unsigned total = 1u << 19;
+
+    std::vector<ex> vars;
+    for (unsigned i = 0; i < 1024; ++i)
+        vars.push_back(ex("x" + num2str(i), 0));
+
+    std::cout << "Building sums term by term\n";
+    std::cout << std::setw(8) << "terms" << std::setw(10) << "sums"
+              << std::setw(14) << "ADD nodes" << std::setw(16) << "heap allocs"
+              << std::setw(12) << "per node" << std::setw(10) << "ms" << '\n';
+    for (unsigned t = 0; t < sizeof(terms) / sizeof(terms[0]); ++t) {
+        unsigned n = terms[t], reps = total / (n * n) + 1;
+        unsigned long nodes = 0, allocs = heap_allocs;
+        std::clock_t start = std::clock();
+        for (unsigned r = 0; r < reps; ++r) {
+            // Coefficients differ between repetitions, so that nodes are not
+            // shared through the unique table
+            ex s = (int) (r + 1) * vars[0];
+            for (unsigned i = 1; i < n; ++i, ++nodes)
+                s = s + (int) (r + i + 1) * vars[i];
+        }
+        double ms = 1000. * (std::clock() - start) / CLOCKS_PER_SEC;
+        allocs = heap_allocs - allocs;
+        std::cout << std::setw(8) << n << std::setw(10) << reps
+                  << std::setw(14) << nodes << std::setw(16) << allocs
+                  << std::setw(12) << std::fixed << std::setprecision(3)
+                  << (nodes ? (double) allocs / nodes : 0.)
+                  << std::setw(10) << std::setprecision(1) << ms << '\n';
+    }
+
+    // Operand lists alone: std::vector (previous layout) and inline storage
+    // with node pools (current layout)
+    std::vector<ptr_base> ptrs;
+    for (unsigned i = 0; i < vars.size(); ++i)
+        ptrs.push_back(vars[i].get_ptr_base());
+    std::cout << "\nBuilding operand lists term by term (heap allocations per list)\n";
+    std::cout << std::setw(8) << "terms" << std::setw(10) << "sums"
+              << std::setw(16) << "vector allocs" << std::setw(12) << "vector ms"
+              << std::setw(18) << "small_vec allocs" << std::setw(14) << "small_vec ms" << '\n';
+    for (unsigned t = 0; t < sizeof(terms) / sizeof(terms[0]); ++t) {
+        unsigned n = terms[t], reps = total / (n * n) + 1;
+        unsigned long va, sa;
+        double vms = build_lists<std::vector<num_ex_pair> >(ptrs, n, reps, va);
+        double sms = build_lists<num_ex_pair_vec_base>(ptrs, n, reps, sa);
+        std::cout << std::setw(8) << n << std::setw(10) << reps
+                  << std::setw(16) << std::fixed << std::setprecision(3) << (double) va / (n * reps)
+                  << std::setw(12) << std::setprecision(1) << vms
+                  << std::setw(18) << std::setprecision(3) << (double) sa / (n * reps)
+                  << std::setw(14) << std::setprecision(1) << sms << '\n';
+    }
+    std::cout << "Expression node allocator statistics:\n"
+              << node_pools::get_instance().stats();
+
+    return 0;
+}
@@ -15,15 +15,22 @@
 #include <model.h>
 #include <model_parse.h>
 #include <utils.h>
+#include <error.h>
+#include <pool.h>
+#include <unique_table.h>
+#include <diff_cache.h>
+#include <trans_cache.h>
+#include <expansion_cache.h>
 #include <stdexcept>
 #include <fstream>
 #include <cstdlib>
 #include <ctime>
+#include <utility>
 
 using symbolic::internal::num2str;
 
 
-Model::Model() : m_deter(false), m_static(false)
+Model::Model() : m_red_budget(0), m_red_budget_set(0), m_deter(false), m_static(false)
 {
     m_options[backwardcomp] = false;
     m_options[verbose] = false;
@@ -32,6 +39,7 @@ Model::Model() : m_deter(false), m_static(false)
     m_options[output_latex_landscape] = false;
     m_options[output_r_long] = false;
     m_options[output_r_jacobian] = true;
+    m_options[simplify] = false;
 #ifdef R_DLL
     m_options[output_r] = true;
     m_options[output_logf] = false;
@@ -41,6 +49,8 @@ Model::Model() : m_deter(false), m_static(false)
 #endif /* R_DLL */
     for (unsigned i = 0; i < OPTIONS_LENGTH; ++i)
         m_options_set[i] = 0;
+    for (unsigned i = 0; i < 4; ++i)
+        m_simpl_size[i] = 0;
 }
 
 
@@ -230,8 +240,9 @@ Model::add_block(const std::string &s, int ln, idx_ex i1, idx_ex i2)
     collect_fidx(i1, imap);
     collect_fidx(i2, imap);
     std::map<unsigned, unsigned>::iterator it;
-    for (it = imap.begin(); it != imap.end(); ++it) {
-        if (!it->second) imap.erase(it);
+    for (it = imap.begin(); it != imap.end(); ) {
+        if (!it->second) imap.erase(it++);
+        else ++it;
     }
     if (imap.size()) {
         unsigned n = imap.size();
@@ -252,12 +263,43 @@ Model::add_block(const std::string &s, int ln, idx_ex i1, idx_ex i2)
         error(mes);
     }
 
-    m_blocks.push_back(Model_block(s, i1, i2));
+    m_blocks.emplace_back(s, std::move(i1), std::move(i2));
 }
 
 
 void
 Model::clear()
 {
+    using namespace symbolic::internal;
+    node_pools &np = node_pools::get_instance();
+#ifdef DEBUG
+    std::string st = np.stats();
+    if (st.size()) std::cerr << "DEBUG INFO: expression node allocator statistics:\n" << st;
+    st = diff_cache::get_instance().stats();
+    if (st.size()) std::cerr << "DEBUG INFO: derivative cache: " << st << '\n';
+    st = trans_cache::get_instance().stats();
+    if (st.size()) std::cerr << "DEBUG INFO: transformation cache: " << st << '\n';
+#endif /* DEBUG */
+    // Expressions held by the model and caches are not freed node by node,
+    // their memory is dropped in one step (pools serve as per-model arena).
+    // DEBUG builds free them through reference counts and check that no
+    // node outlives the model, which would be left dangling by dropping.
+#ifndef DEBUG
+    np.begin_drop();
+#endif /* DEBUG */
     *this = Model();
+    // Derivatives are not reused across models
+    diff_cache::get_instance().clear();
+    // Neither are lags and steady states
+    trans_cache::get_instance().clear();
+    // Nor are expansions of equations
+    expansion_cache::get_instance().clear();
+    // Shared zero node is the last one held
+    ptr_base::release_zero();
+#ifdef DEBUG
+    if (np.live()) INTERNAL_ERROR
+#endif /* DEBUG */
+    unique_table::get_instance().clear();
+    symbolic::idx_set::drop();
+    np.drop();
 }
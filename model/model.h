@@ -35,6 +35,7 @@ class Model {
         output_r,
         output_r_long,
         output_r_jacobian,
+        simplify,
         OPTIONS_LENGTH
     };
 
@@ -114,14 +115,26 @@ class Model {
 
     /// Set option
     void set_option(option o, bool fl = true) { m_options[o] = fl; ++m_options_set[o]; }
+    /// Set integer option by name (lineno is used in error messages)
+    void set_option(const std::string &name, int val, int lineno);
+    /// Set boolean option by name (lineno is used in error messages)
+    void set_option(const std::string &name, bool fl, int lineno);
 
     /// Get option
     bool get_option(option o) { return m_options[o]; }
 
+    /// Effective settings of all options (as text).
+    std::string options_str() const;
+
+    /// Model path
+    const std::string& get_path() const { return m_path; }
+    /// Model name
+    const std::string& get_name() const { return m_name; }
+
     /// Do it.
     void do_it();
 
-    /// Clear.
+    /// Clear (expression node memory is released in bulk).
     void clear();
 
     /// Warning
@@ -147,11 +160,18 @@ class Model {
     /// Produce output
     void write() const;
 
+    /// Names of files produced by write()
+    std::vector<std::string> outputs() const;
+
   private:
 
     // Options
     bool m_options[OPTIONS_LENGTH];
     int m_options_set[OPTIONS_LENGTH];
+    // Reduction budget: max growth of cost of equations in a single
+    // substitution (0 - no limit)
+    int m_red_budget;
+    int m_red_budget_set;
     // Model path and name
     std::string m_path, m_name;
     // Index set names and map
@@ -162,6 +182,11 @@ class Model {
     // Vars for reduction
     vec_exint m_redvars_v;
     set_ex m_redvars;
+    // Substitutions skipped in reduction due to budget (var, growth)
+    map_ex_int m_red_skipped;
+    // Size of equations (nodes) before and after simplification
+    // in blocks and after reduction
+    unsigned m_simpl_size[4];
     // Blocks
     std::vector<Model_block> m_blocks;
     // Variables
@@ -190,12 +215,19 @@ class Model {
     set_ex m_lags;
     // Equations
     set_ex m_eqs, m_t_eqs;
+    // Templates of indexed equations (indexing dropped) and template number
+    // and index values of each element of their expansions
+    vec_ex m_eq_tpls;
+    std::map<ex, std::pair<unsigned, idx_ren>, symbolic::less_ex> m_eq_tpl_map;
     // Steady state equations
     set_ex m_ss, m_t_ss;
     // Calibration eq's
     set_ex m_calibr;
     // Calibration eq's
     set_ex m_calibr_init;
+    // Occurrences of variables, parameters and shocks in equations
+    // and calibrating equations (see collect_occ)
+    std::vector<map_ex_int> m_eq_occ, m_ceq_occ;
     // Variables, parameters / equations, calibrating equations map
     std::map<std::pair<int, int>, unsigned> m_var_eq_map;
     std::set<std::pair<int, int> > m_var_ceq_map;
@@ -230,6 +262,8 @@ class Model {
     void check_names();
     // Substitute definitions
     void subst_defs();
+    // Simplify equations in blocks
+    void simplify_blocks();
     // Check if model is deterministic
     void check_deter();
     // Check Lagrange multipliers
@@ -254,10 +288,16 @@ class Model {
     void collect_calibr();
     // Merge equations
     void collect_eq();
+    // Store template of indexed equation for elements of its expansion
+    void add_eq_tpl(const ex &e, const vec_ex &eqs);
     // Check list of variables for reduction
     void check_red_vars();
     // Reduce equations
     void reduce();
+    // Simplify model and calibrating equations
+    void simplify_eqs();
+    // Construct occurrence index of equations
+    void occ_index();
     // Construct variables / equations map
     void var_eq_map();
     // Construct variables / calibrating equations map
@@ -270,6 +310,10 @@ class Model {
     void shock_eq_map();
     // Steady state
     void stst();
+    // Nonzero derivatives of model equation (for elements of indexed equations
+    // derivatives are taken on templates, see add_eq_tpl)
+    map_int_ex eq_diffs(const ex &e, const vec_ex &vars, const map_ex_int &pos,
+                           std::vector<map_ex_ex> &tdiffs) const;
     // Steady state and calibration eq's Jacobian
     void ss_jacob();
     // 1st order derivatives
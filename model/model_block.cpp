@@ -17,10 +17,13 @@
 #include <utils.h>
 #include <iostream>
 #include <fstream>
+#include <climits>
+#include <algorithm>
 
 using symbolic::internal::num2str;
 using symbolic::internal::DROP_T;
 using symbolic::internal::DIFF_T;
+using symbolic::internal::ANY_T;
 using symbolic::internal::DEFAULT;
 using symbolic::internal::CONVERT_T;
 using symbolic::internal::DROP_T;
@@ -166,6 +169,49 @@ Model_block::subst_defs()
             m_calibr[j].first = m_calibr[j].first.subst(what, with);
         }
     }
+    // Expressions built with deferred canonicalization (see Model::subst_defs)
+    m_obj_eq_in = canon(m_obj_eq_in);
+    m_obj_eq = canon(m_obj_eq);
+    for (unsigned j = 0; j < m_constraints.size(); ++j) {
+        m_constraints_in_lhs[j].first = canon(m_constraints_in_lhs[j].first);
+        m_constraints_in_rhs[j].first = canon(m_constraints_in_rhs[j].first);
+        m_constraints[j].first = canon(m_constraints[j].first);
+    }
+    for (unsigned j = 0; j < m_identities.size(); ++j) {
+        m_identities_in_lhs[j].first = canon(m_identities_in_lhs[j].first);
+        m_identities_in_rhs[j].first = canon(m_identities_in_rhs[j].first);
+        m_identities[j].first = canon(m_identities[j].first);
+    }
+    for (unsigned j = 0; j < m_calibr.size(); ++j) {
+        m_calibr[j].first = canon(m_calibr[j].first);
+    }
+}
+
+
+
+void
+Model_block::simplify(unsigned &before, unsigned &after)
+{
+    if (m_obj_var) {
+        before += cost(m_obj_eq);
+        m_obj_eq = symbolic::simplify(m_obj_eq);
+        after += cost(m_obj_eq);
+    }
+    for (unsigned j = 0; j < m_constraints.size(); ++j) {
+        before += cost(m_constraints[j].first);
+        m_constraints[j].first = symbolic::simplify(m_constraints[j].first);
+        after += cost(m_constraints[j].first);
+    }
+    for (unsigned j = 0; j < m_identities.size(); ++j) {
+        before += cost(m_identities[j].first);
+        m_identities[j].first = symbolic::simplify(m_identities[j].first);
+        after += cost(m_identities[j].first);
+    }
+    for (unsigned j = 0; j < m_calibr.size(); ++j) {
+        before += cost(m_calibr[j].first);
+        m_calibr[j].first = symbolic::simplify(m_calibr[j].first);
+        after += cost(m_calibr[j].first);
+    }
 }
 
 
@@ -281,6 +327,14 @@ Model_block::lags()
             m_identities.push_back(exint(vl1 - vl2, 0));
         }
     }
+    // Expressions built with deferred canonicalization (see Model::lags)
+    m_obj_eq = canon(m_obj_eq);
+    for (unsigned i = 0; i < m_constraints.size(); ++i) {
+        m_constraints[i].first = canon(m_constraints[i].first);
+    }
+    for (unsigned i = 0; i < m_identities.size(); ++i) {
+        m_identities[i].first = canon(m_identities[i].first);
+    }
 }
 
 
@@ -331,9 +385,11 @@ Model_block::derive_focs()
     }
     Z = diff(Z, lag(m_obj_var, 1));
     Z = lag(Z, -1);
+    map_ex_ex etas;
     for (unsigned e = 0; e < m_etas.size(); ++e) {
-        Z = Z.subst(m_etas[e], m_etas_v[e]);
+        etas.insert(std::make_pair(m_etas[e], m_etas_v[e]));
     }
+    Z = Z.subst(etas);
     if ((!Z.hast()) && (!m_obj_lm_in)) redlmagrr = true;
     if (redlmagrr) {
         m_redlm.erase(m_obj_lm);
@@ -342,34 +398,21 @@ Model_block::derive_focs()
         m_focs.push_back(expair(Z - m_obj_lm, m_obj_var));
     }
 
-    // FOCs w.r.t. xs
-    for (unsigned n = 0; n < m_controls.size(); ++n) {
-        ex L, P, M, Q, R, C, mc, eE, x = m_controls[n].first;
+    // FOCs w.r.t. xs (all from one Lagrangian)
+    {
+        ex L, M;
         for (unsigned i = 0; i < m_constraints.size(); ++i) {
-            mc = sum(m_lagr_mult[i].first * m_constraints[i].first);
-            L = L + mc;
-            P = P + lag(mc, 1);
+            L = L + sum(m_lagr_mult[i].first * m_constraints[i].first);
         }
         for (it = m_Es.begin(),  j = 0; it != m_Es.end(); ++it, ++j) {
-            eE = m_etas[j] * *it;
-            M = M + eE;
-            Q = Q + lag(eE, 1);
-        }
-        R = lag(m_obj_eq, 1) + P + Q;
-        if (redlmagrr) {
-            C = m_obj_eq + L + M + E(Z * R, 0);
-        } else {
-            C = m_obj_eq + L + M + E(lag(m_obj_lm, 1) * R, 0);
+            M = M + m_etas[j] * *it;
         }
-        C = diff(C, x);
-        m_focs.push_back(expair(C, x));
+        push_focs(m_obj_eq + L + M, (redlmagrr) ? Z : lag(m_obj_lm, 1), true);
     }
 
     // Substitute for etas from FOCs w.r.t. qs
     for (unsigned n = 0; n < m_focs.size(); ++n) {
-        for (unsigned e = 0; e < m_etas.size(); ++e) {
-            m_focs[n].first = m_focs[n].first.subst(m_etas[e], m_etas_v[e]);
-        }
+        m_focs[n].first = m_focs[n].first.subst(etas);
     }
 
     std::vector<bool> has_lags(m_qs.size(), false);
@@ -393,19 +436,18 @@ Model_block::derive_focs()
             m_constraints.push_back(exint(qq - EE, 0));
         }
     }
+    map_ex_ex qs;
     for (it = m_Es.begin(), j = 0; j < m_qs.size(); ++j, ++it) {
-        ex qq = m_qs[j];
-        ex EE = E(*it, 0);
-
-        if (!has_lags[j]) {
-            for (unsigned i = 0; i < m_focs.size(); ++i) {
-                m_focs[i].first = m_focs[i].first.subst(qq, EE);
-            }
-            for (unsigned i = 0; i < m_constraints.size(); ++i) {
-                m_constraints[i].first = m_constraints[i].first.subst(qq, EE);
-            }
-            m_obj_eq = m_obj_eq.subst(qq, EE);
+        if (!has_lags[j]) qs.insert(std::make_pair(m_qs[j], E(*it, 0)));
+    }
+    if (qs.size()) {
+        for (unsigned i = 0; i < m_focs.size(); ++i) {
+            m_focs[i].first = m_focs[i].first.subst(qs);
+        }
+        for (unsigned i = 0; i < m_constraints.size(); ++i) {
+            m_constraints[i].first = m_constraints[i].first.subst(qs);
         }
+        m_obj_eq = m_obj_eq.subst(qs);
     }
     // reduce
     reduce();
@@ -433,51 +475,109 @@ Model_block::derive_focs_deter()
         m_focs.push_back(expair(lag(A, -1) - m_obj_lm, m_obj_var));
     }
 
-    // FOCs w.r.t. xs
-    for (unsigned n = 0; n < m_controls.size(); ++n) {
-        ex L, P, C, mc, x = m_controls[n].first;
-        for (unsigned i = 0; i < m_constraints.size(); ++i) {
-            mc = sum(m_lagr_mult[i].first * m_constraints[i].first);
-            L = L + mc;
-            P = P + lag(mc, 1);
-        }
-        if (redlmagrr) {
-            C = m_obj_eq + L + A * (lag(m_obj_eq, 1) + P);
-        } else {
-            C = m_obj_eq + L + lag(m_obj_lm, 1) * (lag(m_obj_eq, 1) + P);
-        }
-        C = diff(C, x);
-        m_focs.push_back(expair(C, x));
+    // FOCs w.r.t. xs (all from one Lagrangian)
+    ex L;
+    for (unsigned i = 0; i < m_constraints.size(); ++i) {
+        L = L + sum(m_lagr_mult[i].first * m_constraints[i].first);
     }
+    push_focs(m_obj_eq + L, (redlmagrr) ? A : lag(m_obj_lm, 1), false);
     // reduce
     reduce();
 }
 
 
 
+void
+Model_block::push_focs(const ex &lagr)
+{
+    vec_ex xs;
+    xs.reserve(m_controls.size());
+    for (unsigned n = 0; n < m_controls.size(); ++n) xs.push_back(m_controls[n].first);
+    vec_ex d = diff_each(lagr, xs);
+    for (unsigned n = 0; n < xs.size(); ++n) m_focs.push_back(expair(d[n], xs[n]));
+}
+
+
+
+// Lagrangian shifted one period ahead is not built. Its derivative w.r.t.
+// x is the derivative of lagr w.r.t. x[-1] shifted one period ahead.
+// k (objective's multiplier in t + 1 or an expression without variables)
+// does not depend on controls.
+void
+Model_block::push_focs(const ex &lagr, const ex &k, bool expect)
+{
+    vec_ex xs, lxs;
+    xs.reserve(m_controls.size());
+    lxs.reserve(m_controls.size());
+    for (unsigned n = 0; n < m_controls.size(); ++n) {
+        xs.push_back(m_controls[n].first);
+        lxs.push_back(lag(m_controls[n].first, -1));
+    }
+    // Factors of k not in expectation are taken out of E[] (as E() does)
+    // before differentiation
+    bool kout = (k.get_lag_max(true) <= 0);
+    vec_ex d = diff_each(lagr, xs), ld = diff_each(lagr, lxs);
+    for (unsigned n = 0; n < xs.size(); ++n) {
+        if (ld[n]) {
+            ex s = lag(ld[n], 1);
+            if (!expect) s = s * k;
+            else if (kout) s = k * E(s, 0);
+            else s = E(s * k, 0);
+            d[n] = d[n] + s;
+        }
+        m_focs.push_back(expair(d[n], xs[n]));
+    }
+}
+
+
+
 void
 Model_block::derive_focs_static()
 {
     if (!m_controls.size()) return;
     m_redlm.erase(m_obj_lm);
     m_obj_lm = ex();
-    // FOCs w.r.t. xs
-    for (unsigned n = 0; n < m_controls.size(); ++n) {
-        ex L, P, C, mc, x = m_controls[n].first;
-        for (unsigned i = 0; i < m_constraints.size(); ++i) {
-            mc = sum(m_lagr_mult[i].first * m_constraints[i].first);
-            L = L + mc;
-        }
-        C = m_obj_eq + L;
-        C = diff(C, x);
-        m_focs.push_back(expair(C, x));
+    // FOCs w.r.t. xs (all from one Lagrangian)
+    ex L, C, mc;
+    for (unsigned i = 0; i < m_constraints.size(); ++i) {
+        mc = sum(m_lagr_mult[i].first * m_constraints[i].first);
+        L = L + mc;
     }
+    C = m_obj_eq + L;
+    push_focs(C);
     // reduce
     reduce();
 }
 
 
 
+namespace {
+
+// FOCs waiting for a change in FOCs with a given multiplier
+typedef std::map<ex, std::vector<unsigned> > blocked_map;
+
+// Is substitution of multiplier what from i-th FOC blocked?
+bool
+is_blocked(const blocked_map &blocked, const ex &what, unsigned i)
+{
+    blocked_map::const_iterator it = blocked.find(what);
+    if (it == blocked.end()) return false;
+    return std::find(it->second.begin(), it->second.end(), i) != it->second.end();
+}
+
+// Unblock FOCs waiting for multipliers occurring in e
+void
+wake(const ex &e, blocked_map &blocked)
+{
+    for (blocked_map::iterator it = blocked.begin(); it != blocked.end();) {
+        if (e.has(it->first, ANY_T)) blocked.erase(it++);
+        else ++it;
+    }
+}
+
+} /* namespace */
+
+
 void
 Model_block::reduce()
 {
@@ -485,6 +585,9 @@ Model_block::reduce()
     vec_expair focs_red = m_focs;
     // do it
     unsigned i, n = focs_red.size();
+    // Substitutions exceeding the budget wait for changes in FOCs with
+    // the multiplier (as in Model::reduce)
+    blocked_map blocked;
     bool try_red;
     do {
         try_red = false;
@@ -501,10 +604,37 @@ Model_block::reduce()
                 if (laglead) continue;
             }
             ex what = ts.second, with = ts.third;
+            if (is_blocked(blocked, what, i)) continue;
+            // Only FOCs with what are affected
+            std::vector<std::pair<unsigned, ex> > subs;
+            for (unsigned j = 0; j < n; ++j) {
+                if ((j == i) || !focs_red[j].first.has(what, ANY_T)) continue;
+                subs.push_back(std::make_pair(j, focs_red[j].first.subst(what, with)));
+            }
+            if (m_red_budget) {
+                // Growth of FOCs' cost, substitution is left for
+                // model reduction if it exceeds the budget
+                long growth = -(long) cost(focs_red[i].first);
+                for (unsigned k = 0; k < subs.size(); ++k) {
+                    growth += (long) cost(subs[k].second)
+                              - (long) cost(focs_red[subs[k].first].first);
+                }
+                if (growth > m_red_budget) {
+                    m_red_skipped[what] = (growth > INT_MAX) ? INT_MAX : (int) growth;
+                    blocked[what].push_back(i);
+                    continue;
+                }
+                m_red_skipped.erase(what);
+            }
             m_redlm.erase(what);
+            blocked.erase(what);
+            wake(focs_red[i].first, blocked);
             focs_red[i].first = ex();
-            for (unsigned j = 0; j < n; ++j) {
-                focs_red[j].first = focs_red[j].first.subst(what, with);
+            for (unsigned k = 0; k < subs.size(); ++k) {
+                ex &foc = focs_red[subs[k].first].first;
+                wake(foc, blocked);
+                foc = subs[k].second;
+                wake(foc, blocked);
             }
             try_red = true;
             break;
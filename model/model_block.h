@@ -18,6 +18,7 @@
 
 #include <string>
 #include <vector>
+#include <utility>
 #include <ex.h>
 
 using symbolic::ex;
@@ -27,8 +28,12 @@ using symbolic::set_ex;
 using symbolic::vec_ex;
 using symbolic::map_ex_ex;
 using symbolic::map_ex_int;
+using symbolic::map_int_ex;
 using symbolic::map_ex_str;
 using symbolic::map_str_str;
+using symbolic::internal::idx_ren;
+using symbolic::deferred_canon;
+using symbolic::deferred_phases;
 
 typedef std::pair<ex, std::string> exstr;
 typedef std::pair<ex, int> exint;
@@ -58,7 +63,8 @@ class Model_block {
       
     /// Constructor.
     explicit Model_block(const std::string &n, idx_ex i1 = idx_ex(), idx_ex i2 = idx_ex())
-        : m_name(n), m_i1(i1), m_i2(i2), m_static(false) { ; }
+        : m_name(n), m_i1(std::move(i1)), m_i2(std::move(i2)), m_static(false),
+          m_red_budget(0) { ; }
 
     /// Add definition.
     void add_definition(const ex &lhs, const ex &rhs, int l);
@@ -89,6 +95,10 @@ class Model_block {
     /// Substitute definitions
     void subst_defs();
 
+    /// Simplify equations, their sizes (see symbolic::cost) before
+    /// and after simplification are added to counters.
+    void simplify(unsigned &before, unsigned &after);
+
     /// Handle lags > 1.
     void lags();
 
@@ -142,6 +152,10 @@ class Model_block {
     // Lagrange multipliers.
     vec_exint m_lagr_mult, m_lagr_mult_in;
     set_ex m_redlm;
+    // Reduction budget (see Model) and Lagrange multipliers whose
+    // substitution exceeded it (LM, growth), left for model reduction.
+    int m_red_budget;
+    map_ex_int m_red_skipped;
     // Lagged variables.
     set_ex m_lags;
     // Shocks.
@@ -157,6 +171,11 @@ class Model_block {
     // FOCs.
     vec_expair m_focs, m_focs_red;
 
+    // Append FOCs: derivatives of Lagrangian w.r.t. all controls.
+    void push_focs(const ex &lagr);
+    // Append FOCs: derivatives of lagr + k * lagr(+1) (under E[] if expect
+    // is true) w.r.t. all controls.
+    void push_focs(const ex &lagr, const ex &k, bool expect);
     // FOCs reduction.
     void reduce();
     // Does it have referenced variable (objective, control or LM).
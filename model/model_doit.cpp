@@ -50,6 +50,10 @@ using symbolic::internal::EXACT_T;
 using symbolic::internal::ANY_T;
 using symbolic::internal::DIFF_T;
 using symbolic::internal::LEAD_T;
+using symbolic::internal::OCC_LAG_M1;
+using symbolic::internal::OCC_LAG_0;
+using symbolic::internal::OCC_LAG_P1;
+using symbolic::internal::OCC_LAG_SS;
 using symbolic::triplet;
 
 // former DEBUG_INFO function
@@ -121,6 +125,10 @@ Model::do_it()
 
     DEBUG_INFO("substituting definitions")
     subst_defs();
+    if (m_options[simplify]) {
+        DEBUG_INFO("simplifying equations")
+        simplify_blocks();
+    }
 
     DEBUG_INFO("checking if model is deterministic")
     check_deter();
@@ -199,6 +207,14 @@ Model::do_it()
                          + " with " + num_name_str(m_vars.size(),
                                                    "variable"));
     }
+    if (m_options[simplify]) {
+        DEBUG_INFO("simplifying reduced equations")
+        simplify_eqs();
+        terminate_on_errors();
+    }
+
+    DEBUG_INFO("constructing occurrence index")
+    occ_index();
 
     DEBUG_INFO("constructing variables / equations equations map")
     var_eq_map();
@@ -243,6 +259,7 @@ Model::get_option_name(int o)
         case Model::output_r: return "output R";
         case Model::output_r_long: return "output R long";
         case Model::output_r_jacobian: return "output R Jacobian";
+        case Model::simplify: return "simplify";
         default:
             INTERNAL_ERROR
     }
@@ -250,6 +267,44 @@ Model::get_option_name(int o)
 
 
 
+void
+Model::set_option(const std::string &name, int val, int lineno)
+{
+    if (name == "reduction_budget") {
+        m_red_budget = val;
+        ++m_red_budget_set;
+    } else {
+        error("unknown option \"" + name + "\"; error near line " + num2str(lineno));
+    }
+}
+
+
+
+void
+Model::set_option(const std::string &name, bool fl, int lineno)
+{
+    if (name == "simplify") {
+        set_option(simplify, fl);
+    } else {
+        error("unknown option \"" + name + "\"; error near line " + num2str(lineno));
+    }
+}
+
+
+
+std::string
+Model::options_str() const
+{
+    std::string res;
+    for (int i = 0; i < OPTIONS_LENGTH; ++i) {
+        res += get_option_name(i) + (m_options[i] ? " = true;\n" : " = false;\n");
+    }
+    res += "reduction_budget = " + num2str(m_red_budget) + ";\n";
+    return res;
+}
+
+
+
 void
 Model::check_options()
 {
@@ -273,6 +328,10 @@ Model::check_options()
                     + (m_options[i] ? "true)" : "false)"));
         }
     }
+    if (m_red_budget_set > 1) {
+        warning("option \"reduction_budget\" set more than once; assuming the last setting ("
+                + num2str(m_red_budget) + ')');
+    }
 }
 
 
@@ -507,8 +566,9 @@ Model::check_findices()
         std::map<unsigned, unsigned> imap;
         std::map<unsigned, unsigned>::iterator it;
         collect_fidx(e, imap);
-        for (it = imap.begin(); it != imap.end(); ++it) {
-            if (!it->second) imap.erase(it);
+        for (it = imap.begin(); it != imap.end(); ) {
+            if (!it->second) imap.erase(it++);
+            else ++it;
         }
         if (imap.size()) error_findices(imap, e, line);
         imap.clear();
@@ -525,8 +585,9 @@ Model::check_findices()
 collect_fidx(m_blocks[i].m_i1, imap); \
 collect_fidx(m_blocks[i].m_i2, imap); \
 collect_fidx(e, imap); \
-for (it = imap.begin(); it != imap.end(); ++it) { \
-    if (!it->second) imap.erase(it); \
+for (it = imap.begin(); it != imap.end(); ) { \
+    if (!it->second) imap.erase(it++); \
+    else ++it; \
 } \
 if (imap.size()) error_findices(imap, ex(m_blocks[i].m_i1, ex(m_blocks[i].m_i2, e)), line); \
 imap.clear();
@@ -675,6 +736,8 @@ Model::check_names()
 void
 Model::subst_defs()
 {
+    // Expressions are canonicalized once after all substitutions
+    deferred_canon dc(deferred_phases());
     for (unsigned i = 0, n = m_blocks.size(); i < n; ++i) {
         m_blocks[i].subst_defs();
     }
@@ -682,6 +745,23 @@ Model::subst_defs()
 
 
 
+void
+Model::simplify_blocks()
+{
+    unsigned before = 0, after = 0;
+    for (unsigned i = 0, n = m_blocks.size(); i < n; ++i) {
+        m_blocks[i].simplify(before, after);
+    }
+    m_simpl_size[0] = before;
+    m_simpl_size[1] = after;
+    if (m_options[verbose]) {
+        write_model_info("simplification reduced the size of equations in blocks from "
+                         + num2str(before) + " to " + num2str(after) + " nodes");
+    }
+}
+
+
+
 void
 Model::check_lagr()
 {
@@ -1080,6 +1160,8 @@ Model::leads()
 void
 Model::lags()
 {
+    // Expressions are canonicalized once after all substitutions
+    deferred_canon dc(deferred_phases());
     m_min_lag = 0;
     for (unsigned i = 0, n = m_blocks.size(); i < n; ++i) {
         int bmlag = 0, mlag;
@@ -1210,6 +1292,7 @@ Model::derive_focs()
             }
         }
         // Derive FOCs
+        m_blocks[i].m_red_budget = m_red_budget;
         if (m_blocks[i].m_static) {
             m_blocks[i].derive_focs_static();
         } else if (m_deter) {
@@ -1223,6 +1306,19 @@ Model::derive_focs()
                         + m_blocks[i].m_focs[f].second.str() + "\") in " + m_blocks[i].m_name +
                         "\'s problem is of the form 0 = 0;");
         }
+        if (m_options[verbose] && m_blocks[i].m_red_skipped.size()) {
+            const map_ex_int &sk = m_blocks[i].m_red_skipped;
+            std::string vlst;
+            for (map_ex_int::const_iterator it = sk.begin(); it != sk.end();) {
+                vlst += "\"" + it->first.str() + "\" (+" + num2str(it->second) + ")";
+                if (++it != sk.end()) {
+                    vlst += ", ";
+                }
+            }
+            write_model_info("substitution(s) of the following Lagrange multiplier(s) in "
+                             + m_blocks[i].m_name + "\'s problem were deferred to model \
+reduction as the growth of FOCs (in brackets) exceeded the reduction budget: " + vlst);
+        }
     }
 }
 
@@ -1412,7 +1508,10 @@ Model::collect_eq()
                     warning("repeating equation: " + itp->first.str() + " = 0");
                 }
             }
-            if (eqs.size()) m_t_eqs.insert(e);
+            if (eqs.size()) {
+                m_t_eqs.insert(e);
+                add_eq_tpl(e, eqs);
+            }
         }
         if (m_blocks[i].m_obj_eq) {
             ex lhs = m_blocks[i].m_obj_var, rhs = m_blocks[i].m_obj_eq;
@@ -1425,7 +1524,10 @@ Model::collect_eq()
                             + m_blocks[i].m_obj_eq.str() + "\" is duplicated");
                 }
             }
-            if (eqs.size()) m_t_eqs.insert(e);
+            if (eqs.size()) {
+                m_t_eqs.insert(e);
+                add_eq_tpl(e, eqs);
+            }
         }
         std::vector<exint>::const_iterator it, ite;
         it = m_blocks[i].m_constraints.begin();
@@ -1441,7 +1543,10 @@ Model::collect_eq()
                             + "near line " + num2str(it->second));
                 }
             }
-            if (eqs.size()) m_t_eqs.insert(e);
+            if (eqs.size()) {
+                m_t_eqs.insert(e);
+                add_eq_tpl(e, eqs);
+            }
         }
         it = m_blocks[i].m_identities.begin();
         ite = m_blocks[i].m_identities.end();
@@ -1456,7 +1561,10 @@ Model::collect_eq()
                             + "near line " + num2str(it->second));
                 }
             }
-            if (eqs.size()) m_t_eqs.insert(e);
+            if (eqs.size()) {
+                m_t_eqs.insert(e);
+                add_eq_tpl(e, eqs);
+            }
         }
     }
 
@@ -1473,6 +1581,25 @@ Model::collect_eq()
 
 
 
+void
+Model::add_eq_tpl(const ex &e, const vec_ex &eqs)
+{
+    std::vector<idx_ren> values;
+    ex tpl = expand_idx(e, values);
+    if (values.size() != eqs.size()) INTERNAL_ERROR
+    // Derivatives of products over indices differ in form from those of
+    // their expansions, such templates are not used
+    if (values[0].empty() || tpl.has_prods()) return;
+    unsigned n = m_eq_tpls.size();
+    m_eq_tpls.push_back(tpl);
+    for (unsigned i = 0; i < eqs.size(); ++i) {
+        m_eq_tpl_map.insert(std::pair<ex, std::pair<unsigned, idx_ren> >(
+                                eqs[i], std::pair<unsigned, idx_ren>(n, values[i])));
+    }
+}
+
+
+
 void
 Model::collect_calibr()
 {
@@ -1686,6 +1813,26 @@ Model::check_red_vars()
 }
 
 
+namespace {
+
+// Equations waiting for a change in equations with a given variable
+typedef std::map<ex, std::vector<unsigned> > blocked_map;
+
+// Move equations waiting for variables occurring in occ to the worklist
+void
+wake(const map_ex_int &occ, blocked_map &blocked, std::set<unsigned> &work)
+{
+    if (blocked.empty()) return;
+    for (map_ex_int::const_iterator it = occ.begin(); it != occ.end(); ++it) {
+        blocked_map::iterator bit = blocked.find(it->first);
+        if (bit == blocked.end()) continue;
+        work.insert(bit->second.begin(), bit->second.end());
+        blocked.erase(bit);
+    }
+}
+
+} /* namespace */
+
 
 void
 Model::reduce()
@@ -1697,57 +1844,109 @@ Model::reduce()
     for (set_ex::iterator it = m_calibr.begin(); it != m_calibr.end(); ++it) eqsc.push_back(*it);
 
     unsigned i, n = eqs.size(), nc = eqsc.size();
-    bool try_red;
-    do {
-        try_red = false;
-        for (i = 0; i < n; ++i) {
-            triplet<bool, ex, ex> ts = find_subst(eqs[i], m_redvars);
-            if (!ts.first) continue;
-            if (ts.third.hast()) {
-                ex e = ts.second, lde = lag(e, 1), lge = lag(e, -1);
-                int ld = 0, lg = 0;
-                for (unsigned i = 0; i < n; ++i) {
-                    if (eqs[i].has(lde)) {
-                        ld = 1;
-                    }
-                    if (eqs[i].has(lge)) {
-                        lg = -1;
-                    }
-                    if (ld && lg) break;
+    map_ex_ex ssshocks;
+    for (set_ex::const_iterator lit = m_shocks.begin(); lit != m_shocks.end(); ++lit) {
+        ssshocks.insert(std::make_pair(ss(*lit), ex()));
+    }
+    std::vector<map_ex_int> occ(n), occc(nc);
+    for (i = 0; i < n; ++i) collect_occ(eqs[i], occ[i]);
+    for (i = 0; i < nc; ++i) collect_occ(eqsc[i], occc[i]);
+    // Worklist of equations which may yield a substitution. An equation
+    // leaves it when it does not and comes back only when it changes or,
+    // if blocked by leads / lags of the variable, when equations with that
+    // variable change. Taking the lowest index first gives the same order
+    // of substitutions as rescanning all equations after each of them.
+    std::set<unsigned> work;
+    for (i = 0; i < n; ++i) work.insert(work.end(), i);
+    blocked_map blocked;
+    while (!work.empty() && m_redvars.size()) {
+        i = *work.begin();
+        work.erase(work.begin());
+        triplet<bool, ex, ex> ts = find_subst(eqs[i], m_redvars);
+        if (!ts.first) continue;
+        if (ts.third.hast()) {
+            ex e = ts.second, lde = lag(e, 1), lge = lag(e, -1), e0 = lag0(e);
+            int ld = 0, lg = 0;
+            for (unsigned k = 0; k < n; ++k) {
+                if (occ[k].find(e0) == occ[k].end()) continue;
+                if (eqs[k].has(lde)) {
+                    ld = 1;
                 }
-                if (ts.third.get_lag_max() + ld > 1) continue;
-                if (ts.third.get_lag_min() + lg < -1) continue;
-                // check if we have shocks on RHS in substitution
-                bool hasshock = false;
-                for (set_ex::const_iterator lit = m_shocks.begin();
-                     lit != m_shocks.end(); ++lit) {
-                    if (ts.third.has(*lit)) {
-                        hasshock = true;
-                        break;
-                    }
+                if (eqs[k].has(lge)) {
+                    lg = -1;
                 }
-                if (hasshock && (ld || lg)) continue;
-            }
-            ex what = ts.second, with = ts.third;
-            m_lagr_mult.erase(what);
-            m_lags.erase(what);
-            m_vars.erase(what);
-            m_redvars.erase(what);
-            eqs[i] = ex();
-            for (unsigned j = 0; j < n; ++j) {
-                eqs[j] = eqs[j].subst(what, with);
-            }
-            for (unsigned j = 0; j < nc; ++j) {
-                eqsc[j] = eqsc[j].subst(what, with);
-                for (set_ex::const_iterator lit = m_shocks.begin();
-                     lit != m_shocks.end(); ++lit) {
-                    eqsc[j] = eqsc[j].subst(ss(*lit), ex());
+                if (ld && lg) break;
+            }
+            if ((ts.third.get_lag_max() + ld > 1)
+                || (ts.third.get_lag_min() + lg < -1)) {
+                blocked[e0].push_back(i);
+                continue;
+            }
+            // check if we have shocks on RHS in substitution
+            bool hasshock = false;
+            for (set_ex::const_iterator lit = m_shocks.begin();
+                 lit != m_shocks.end(); ++lit) {
+                if (ts.third.has(*lit)) {
+                    hasshock = true;
+                    break;
                 }
             }
-            try_red = true;
-            break;
+            if (hasshock && (ld || lg)) {
+                blocked[e0].push_back(i);
+                continue;
+            }
+        }
+        ex what = ts.second, with = ts.third, what0 = lag0(what);
+        // Only equations with what (in any lag) are affected
+        std::vector<std::pair<unsigned, ex> > subs, subsc;
+        for (unsigned j = 0; j < n; ++j) {
+            if ((j == i) || (occ[j].find(what0) == occ[j].end())) continue;
+            subs.push_back(std::make_pair(j, eqs[j].subst(what, with)));
+        }
+        for (unsigned j = 0; j < nc; ++j) {
+            if (occc[j].find(what0) == occc[j].end()) continue;
+            subsc.push_back(std::make_pair(j, eqsc[j].subst(what, with).subst(ssshocks)));
+        }
+        // Growth of equations' cost, substitution waits for changes
+        // in equations with what if it exceeds the budget
+        if (m_red_budget) {
+            long growth = -(long) cost(eqs[i]);
+            for (unsigned k = 0; k < subs.size(); ++k) {
+                growth += (long) cost(subs[k].second) - (long) cost(eqs[subs[k].first]);
+            }
+            for (unsigned k = 0; k < subsc.size(); ++k) {
+                growth += (long) cost(subsc[k].second) - (long) cost(eqsc[subsc[k].first]);
+            }
+            if (growth > m_red_budget) {
+                m_red_skipped[what] = (growth > INT_MAX) ? INT_MAX : (int) growth;
+                blocked[what0].push_back(i);
+                continue;
+            }
+            m_red_skipped.erase(what);
         }
-    } while (try_red && m_redvars.size());
+        m_lagr_mult.erase(what);
+        m_lags.erase(what);
+        m_vars.erase(what);
+        m_redvars.erase(what);
+        eqs[i] = ex();
+        wake(occ[i], blocked, work);
+        occ[i].clear();
+        for (unsigned k = 0; k < subs.size(); ++k) {
+            unsigned j = subs[k].first;
+            eqs[j] = subs[k].second;
+            wake(occ[j], blocked, work);
+            occ[j].clear();
+            collect_occ(eqs[j], occ[j]);
+            wake(occ[j], blocked, work);
+            work.insert(j);
+        }
+        for (unsigned k = 0; k < subsc.size(); ++k) {
+            unsigned j = subsc[k].first;
+            eqsc[j] = subsc[k].second;
+            occc[j].clear();
+            collect_occ(eqsc[j], occc[j]);
+        }
+    }
 
     m_eqs.clear();
     for (i = 0; i < n; ++i) {
@@ -1811,6 +2010,59 @@ symbolically reduced in the model: " + vlst);
         write_model_info("the following internally generated variable(s) could not be \
 symbolically reduced in the model: " + vlst);
     }
+    if (m_options[verbose] && m_red_skipped.size()) {
+        std::string vlst;
+        print_flag pflag = (m_static) ? DROP_T : DEFAULT;
+        for (map_ex_int::const_iterator it = m_red_skipped.begin();
+             it != m_red_skipped.end();) {
+            vlst += "\"" + it->first.str(pflag) + "\" (+" + num2str(it->second) + ")";
+            if (++it != m_red_skipped.end()) {
+                vlst += ", ";
+            }
+        }
+        write_model_info("substitution(s) of the following variable(s) were skipped as \
+the growth of equations (in brackets) exceeded the reduction budget ("
+                         + num2str(m_red_budget) + "): " + vlst);
+    }
+}
+
+
+
+void
+Model::simplify_eqs()
+{
+    unsigned before = 0, after = 0;
+    print_flag pflag = (m_static) ? DROP_T : DEFAULT;
+    set_ex eqs, calibr;
+    for (set_ex::const_iterator it = m_eqs.begin(); it != m_eqs.end(); ++it) {
+        ex e = symbolic::simplify(*it);
+        before += cost(*it);
+        after += cost(e);
+        if (!e) {
+            error("equation \"" + it->str(pflag) + " = 0\" simplifies to \"0 = 0\"");
+        } else if (!eqs.insert(e).second) {
+            warning("repeating equation after simplification: " + e.str(pflag) + " = 0");
+        }
+    }
+    for (set_ex::const_iterator it = m_calibr.begin(); it != m_calibr.end(); ++it) {
+        ex e = symbolic::simplify(*it);
+        before += cost(*it);
+        after += cost(e);
+        if (!e) {
+            error("calibrating equation \"" + it->str(pflag) + " = 0\" simplifies to \"0 = 0\"");
+        } else if (!calibr.insert(e).second) {
+            warning("repeating calibrating equation after simplification: "
+                    + e.str(pflag) + " = 0");
+        }
+    }
+    m_eqs.swap(eqs);
+    m_calibr.swap(calibr);
+    m_simpl_size[2] = before;
+    m_simpl_size[3] = after;
+    if (m_options[verbose]) {
+        write_model_info("simplification reduced the size of equations from "
+                         + num2str(before) + " to " + num2str(after) + " nodes");
+    }
 }
 
 
@@ -1820,48 +2072,65 @@ namespace {
 
 enum lag_flags {
     NUL    =     0,
-    LAG_M1 =   0x1,
-    LAG_0  =   0x2,
-    LAG_P1 =   0x4,
-    LAG_SS =   0x8
+    LAG_M1 = OCC_LAG_M1,
+    LAG_0  = OCC_LAG_0,
+    LAG_P1 = OCC_LAG_P1,
+    LAG_SS = OCC_LAG_SS
 };
 
+
+// Positions (from 1) of expressions in a set
+map_ex_int
+positions(const set_ex &s)
+{
+    map_ex_int res;
+    int j = 1;
+    for (set_ex::const_iterator it = s.begin(); it != s.end(); ++it, ++j) {
+        res.insert(res.end(), std::pair<ex, int>(*it, j));
+    }
+    return res;
+}
+
 } /* namespace */
 
 
+void
+Model::occ_index()
+{
+    set_ex::const_iterator it;
+
+    m_eq_occ.assign(m_eqs.size(), map_ex_int());
+    m_ceq_occ.assign(m_calibr.size(), map_ex_int());
+    std::vector<map_ex_int>::iterator oit;
+    for (it = m_eqs.begin(), oit = m_eq_occ.begin(); it != m_eqs.end(); ++it, ++oit) {
+        collect_occ(*it, *oit);
+    }
+    for (it = m_calibr.begin(), oit = m_ceq_occ.begin(); it != m_calibr.end(); ++it, ++oit) {
+        collect_occ(*it, *oit);
+    }
+}
+
+
 void
 Model::var_eq_map()
 {
-    int i, j;
+    int i;
     unsigned flag;
-    set_ex::const_iterator it1, it2;
-    ex x, e;
-
-    if (m_static) {
-        for (it1 = m_eqs.begin(), i = 1; it1 != m_eqs.end(); ++it1, ++i) {
-            e = *it1;
-            for (it2 = m_vars.begin(), j = 1; it2 != m_vars.end(); ++it2, ++j) {
-                x = *it2;
-                if (e.has(x)) m_var_eq_map.insert(std::pair<std::pair<int, int>, unsigned>(
-                                            std::pair<int, int>(i, j), LAG_0));
-            }
-        }
-    } else {
-        for (it1 = m_eqs.begin(), i = 1; it1 != m_eqs.end(); ++it1, ++i) {
-            e = *it1;
-            for (it2 = m_vars.begin(), j = 1; it2 != m_vars.end(); ++it2, ++j) {
-                flag = 0;
-                x = lag(*it2, -1);
-                if (e.has(x)) flag |= LAG_M1;
-                x = *it2;
-                if (e.has(x)) flag |= LAG_0;
-                x = lag(*it2, 1);
-                if (e.has(x)) flag |= LAG_P1;
-                x = ss(*it2);
-                if (e.has(x)) flag |= LAG_SS;
-                if (flag) m_var_eq_map.insert(std::pair<std::pair<int, int>, unsigned>(
-                                            std::pair<int, int>(i, j), flag));
+    map_ex_int::const_iterator it, itp;
+    map_ex_int pos = positions(m_vars);
+
+    for (i = 1; i <= (int) m_eq_occ.size(); ++i) {
+        const map_ex_int &occ = m_eq_occ[i - 1];
+        for (it = occ.begin(); it != occ.end(); ++it) {
+            itp = pos.find(it->first);
+            if (itp == pos.end()) continue;
+            if (m_static) {
+                flag = it->second & LAG_0;
+            } else {
+                flag = it->second & (LAG_M1 | LAG_0 | LAG_P1 | LAG_SS);
             }
+            if (flag) m_var_eq_map.insert(std::pair<std::pair<int, int>, unsigned>(
+                                        std::pair<int, int>(i, itp->second), flag));
         }
     }
 }
@@ -1870,18 +2139,21 @@ Model::var_eq_map()
 void
 Model::shock_eq_map()
 {
-    int i, j;
-    set_ex::const_iterator it1, it2;
-    ex x, e;
+    int i;
+    set_ex::const_iterator it1;
+    map_ex_int::const_iterator it, itp;
+    map_ex_int pos = positions(m_shocks);
 
     for (it1 = m_eqs.begin(), i = 1; it1 != m_eqs.end(); ++it1, ++i) {
-        e = *it1;
-        for (it2 = m_shocks.begin(), j = 1; it2 != m_shocks.end(); ++it2, ++j) {
-            if (e.has(*it2, DIFF_T)) {
-                error("shock \"" + it2->str() + "\" in equation \"" + it1->str()
+        const map_ex_int &occ = m_eq_occ[i - 1];
+        for (it = occ.begin(); it != occ.end(); ++it) {
+            itp = pos.find(it->first);
+            if (itp == pos.end()) continue;
+            if (it->second & ~LAG_0) {
+                error("shock \"" + it->first.str() + "\" in equation \"" + it1->str()
                       + "\" has invalid time index; shocks should have time index 0");
             }
-            if (e.has(*it2)) m_shock_eq_map.insert(std::pair<int, int>(i, j));
+            if (it->second & LAG_0) m_shock_eq_map.insert(std::pair<int, int>(i, itp->second));
         }
     }
 }
@@ -1898,16 +2170,23 @@ Model::stst()
 
     if (m_static) return;
 
+    map_ex_ex ssshocks;
+    for (it2 = m_shocks.begin(); it2 != m_shocks.end(); ++it2) {
+        ssshocks.insert(std::make_pair(ss(*it2), ex()));
+    }
+
     for (it = m_eqs.begin(); it != m_eqs.end(); ++it) {
-        ex ssex = ss(*it);
-        if (!ssex) {
+        ex ssex;
+        {
+            // Steady state is canonicalized once after shocks are set to 0
+            deferred_canon dc(deferred_phases());
+            ssex = canon(ss(*it).subst(ssshocks));
+        }
+        if (!ssex && !ss(*it)) {
             error("steady state equation \"0 = 0\" derived from \""
                 + it->str() + "\"");
             continue;
         }
-        for (it2 = m_shocks.begin(); it2 != m_shocks.end(); ++it2) {
-            ssex = ssex.subst(ss(*it2), ex());
-        }
         if (!m_ss.insert(ssex).second) {
             warning("repeating steady state equation: " + ssex.str() + " = 0");
         }
@@ -1928,156 +2207,137 @@ Model::stst()
 void
 Model::var_ceq_map()
 {
-    int i, j;
-    set_ex::const_iterator it1, it2;
+    int i;
+    map_ex_int::const_iterator it, itp;
+    map_ex_int pos = positions(m_vars);
 
-    if (m_static) {
-        for (it1 = m_calibr.begin(), i = 1; it1 != m_calibr.end(); ++it1, ++i) {
-            for (it2 = m_vars.begin(), j = 1; it2 != m_vars.end(); ++it2, ++j) {
-                if (it1->has(*it2)) {
-                    m_var_ceq_map.insert(std::pair<int, int>(i, j));
-                }
+    for (i = 1; i <= (int) m_ceq_occ.size(); ++i) {
+        const map_ex_int &occ = m_ceq_occ[i - 1];
+        for (it = occ.begin(); it != occ.end(); ++it) {
+            itp = pos.find(it->first);
+            if (itp == pos.end()) continue;
+            if ((m_static && (it->second & LAG_0)) || (it->second & LAG_SS)) {
+                m_var_ceq_map.insert(std::pair<int, int>(i, itp->second));
             }
         }
     }
-    for (it1 = m_calibr.begin(), i = 1; it1 != m_calibr.end(); ++it1, ++i) {
-        for (it2 = m_vars.begin(), j = 1; it2 != m_vars.end(); ++it2, ++j) {
-            if (it1->has(ss(*it2))) m_var_ceq_map.insert(std::pair<int, int>(i, j));
-        }
-    }
 }
 
 
 
+namespace {
+
+// Fill parameters / equations maps from occurrence index
 void
-Model::par_eq_map()
+par_map(const std::vector<map_ex_int> &occs, const set_ex &params_calibr,
+        const set_ex &params_free, std::set<std::pair<int, int> > &cmap,
+        std::set<std::pair<int, int> > &fmap)
 {
-    int i, j;
-    set_ex::const_iterator it1, it2;
-    ex x, r, e;
+    map_ex_int cpos = positions(params_calibr), fpos = positions(params_free);
+    map_ex_int::const_iterator it, itp;
 
-    for (it1 = m_eqs.begin(), i = 1; it1 != m_eqs.end(); ++it1, ++i) {
-        for (it2 = m_params_calibr.begin(), j = 1; it2 != m_params_calibr.end(); ++it2, ++j) {
-            if (it1->has(*it2)) m_cpar_eq_map.insert(std::pair<int, int>(i, j));
-        }
-        for (it2 = m_params_free.begin(), j = 1; it2 != m_params_free.end(); ++it2, ++j) {
-            if (it1->has(*it2)) m_fpar_eq_map.insert(std::pair<int, int>(i, j));
+    for (int i = 1; i <= (int) occs.size(); ++i) {
+        const map_ex_int &occ = occs[i - 1];
+        for (it = occ.begin(); it != occ.end(); ++it) {
+            if (!(it->second & LAG_0)) continue;
+            if ((itp = cpos.find(it->first)) != cpos.end()) {
+                cmap.insert(std::pair<int, int>(i, itp->second));
+            }
+            if ((itp = fpos.find(it->first)) != fpos.end()) {
+                fmap.insert(std::pair<int, int>(i, itp->second));
+            }
         }
     }
 }
 
+} /* namespace */
+
+
+void
+Model::par_eq_map()
+{
+    par_map(m_eq_occ, m_params_calibr, m_params_free, m_cpar_eq_map, m_fpar_eq_map);
+}
+
 
 
 void
 Model::par_ceq_map()
 {
-    int i, j;
-    set_ex::const_iterator it1, it2;
+    par_map(m_ceq_occ, m_params_calibr, m_params_free, m_cpar_ceq_map, m_fpar_ceq_map);
+}
 
-    for (it1 = m_calibr.begin(), i = 1; it1 != m_calibr.end(); ++it1, ++i) {
-        for (it2 = m_params_calibr.begin(), j = 1; it2 != m_params_calibr.end(); ++it2, ++j) {
-            if (it1->has(*it2)) m_cpar_ceq_map.insert(std::pair<int, int>(i, j));
-        }
-        for (it2 = m_params_free.begin(), j = 1; it2 != m_params_free.end(); ++it2, ++j) {
-            if (it1->has(*it2)) m_fpar_ceq_map.insert(std::pair<int, int>(i, j));
-        }
+
+
+namespace {
+
+// Insert nonzero derivatives into row i of a sparse matrix,
+// column of element j is j + 1
+void
+insert_diffs(std::map<std::pair<int, int>, ex> &m, int i, const map_int_ex &d)
+{
+    for (map_int_ex::const_iterator it = d.begin(); it != d.end(); ++it) {
+        if (it->second) m.insert(std::pair<std::pair<int, int>, ex>(
+                                    std::pair<int, int>(i, it->first + 1), it->second));
     }
 }
 
+// Steady state of derivatives with shocks set to 0
+map_int_ex
+ss_noshocks(const map_int_ex &d, const map_ex_ex &ssshocks)
+{
+    map_int_ex res;
+    deferred_canon dc(deferred_phases());
+    for (map_int_ex::const_iterator it = d.begin(); it != d.end(); ++it) {
+        if (it->second) res.insert(res.end(), std::pair<int, ex>(it->first,
+                                                                 canon(ss(it->second).subst(ssshocks))));
+    }
+    return res;
+}
 
+} /* namespace */
 
 
+map_int_ex
+Model::eq_diffs(const ex &e, const vec_ex &vars, const map_ex_int &pos,
+                   std::vector<map_ex_ex> &tdiffs) const
+{
+    // Elements of indexed equations left intact by reduction share
+    // derivatives of their template
+    std::map<ex, std::pair<unsigned, idx_ren>, symbolic::less_ex>::const_iterator it;
+    it = m_eq_tpl_map.find(e);
+    if (it == m_eq_tpl_map.end()) return diff_each(e, vars, pos);
+    unsigned n = it->second.first;
+    return diff_each(e, m_eq_tpls[n], it->second.second, vars, pos, tdiffs[n]);
+}
 
 
 void
 Model::ss_jacob()
 {
-    int i, j, nv = m_vars.size(), ne = m_eqs.size();
-    set_ex::const_iterator it0, it1, it2;
-    ex x, e, r;
+    int i, ne = m_eqs.size();
+    set_ex::const_iterator it;
+    vec_ex vars;
 
+    // Variables followed by calibrated parameters
+    for (it = m_vars.begin(); it != m_vars.end(); ++it) {
+        vars.push_back((m_static) ? *it : ss(*it));
+    }
+    vars.insert(vars.end(), m_params_calibr.begin(), m_params_calibr.end());
+    map_ex_int pos = diff_pos(vars);
     if (m_static) {
-        for (it0 = m_eqs.begin(), i = 1; it0 != m_eqs.end(); ++it0, ++i) {
-            e = *it0;
-            for (it2 = m_vars.begin(), j = 1; it2 != m_vars.end(); ++it2, ++j) {
-                x = *it2;
-                r = diff(e, x);
-                if (r) {
-                    m_jacob_ss_calibr.insert(std::pair<std::pair<int, int>, ex>(
-                                    std::pair<int, int>(i, j), r));
-                }
-            }
-        }
-        for (it0 = m_eqs.begin(), i = 1; it0 != m_eqs.end(); ++it0, ++i) {
-            e = *it0;
-            for (it2 = m_params_calibr.begin(), j = 1;
-                it2 != m_params_calibr.end(); ++it2, ++j) {
-                x = *it2;
-                r = diff(e, x);
-                if (r) {
-                    m_jacob_ss_calibr.insert(std::pair<std::pair<int, int>, ex>(
-                                    std::pair<int, int>(i, j + nv), r));
-                }
-            }
-        }
-        for (it1 = m_calibr.begin(), i = 1; it1 != m_calibr.end(); ++it1, ++i) {
-            e = *it1;
-            for (it2 = m_vars.begin(), j = 1; it2 != m_vars.end(); ++it2, ++j) {
-                x = *it2;
-                r = diff(e, x);
-                if (r) {
-                    m_jacob_ss_calibr.insert(std::pair<std::pair<int, int>, ex>(
-                                    std::pair<int, int>(i + ne, j), r));
-                }
-            }
+        // Static model: steady state equations are model equations
+        std::vector<map_ex_ex> tdiffs(m_eq_tpls.size());
+        for (it = m_eqs.begin(), i = 1; it != m_eqs.end(); ++it, ++i) {
+            insert_diffs(m_jacob_ss_calibr, i, eq_diffs(*it, vars, pos, tdiffs));
         }
     } else {
-        for (it0 = m_ss.begin(), i = 1; it0 != m_ss.end(); ++it0, ++i) {
-            e = *it0;
-            for (it2 = m_vars.begin(), j = 1; it2 != m_vars.end(); ++it2, ++j) {
-                x = ss(*it2);
-                r = diff(e, x);
-                if (r) {
-                    m_jacob_ss_calibr.insert(std::pair<std::pair<int, int>, ex>(
-                                    std::pair<int, int>(i, j), r));
-                }
-            }
-        }
-        for (it0 = m_ss.begin(), i = 1; it0 != m_ss.end(); ++it0, ++i) {
-            e = *it0;
-            for (it2 = m_params_calibr.begin(), j = 1;
-                it2 != m_params_calibr.end(); ++it2, ++j) {
-                x = *it2;
-                r = diff(e, x);
-                if (r) {
-                    m_jacob_ss_calibr.insert(std::pair<std::pair<int, int>, ex>(
-                                    std::pair<int, int>(i, j + nv), r));
-                }
-            }
-        }
-        for (it1 = m_calibr.begin(), i = 1; it1 != m_calibr.end(); ++it1, ++i) {
-            e = *it1;
-            for (it2 = m_vars.begin(), j = 1; it2 != m_vars.end(); ++it2, ++j) {
-                x = ss(*it2);
-                r = diff(e, x);
-                if (r) {
-                    m_jacob_ss_calibr.insert(std::pair<std::pair<int, int>, ex>(
-                                    std::pair<int, int>(i + ne, j), r));
-                }
-            }
+        for (it = m_ss.begin(), i = 1; it != m_ss.end(); ++it, ++i) {
+            insert_diffs(m_jacob_ss_calibr, i, diff_each(*it, vars, pos));
         }
     }
-    for (it1 = m_calibr.begin(), i = 1; it1 != m_calibr.end(); ++it1, ++i) {
-        e = *it1;
-        for (it2 = m_params_calibr.begin(), j = 1;
-             it2 != m_params_calibr.end(); ++it2, ++j) {
-            x = *it2;
-            r = diff(e, x);
-            if (r) {
-                m_jacob_ss_calibr.insert(std::pair<std::pair<int, int>, ex>(
-                                  std::pair<int, int>(i + ne, j + nv), r));
-            }
-        }
+    for (it = m_calibr.begin(), i = 1; it != m_calibr.end(); ++it, ++i) {
+        insert_diffs(m_jacob_ss_calibr, i + ne, diff_each(*it, vars, pos));
     }
 }
 
@@ -2087,68 +2347,28 @@ Model::ss_jacob()
 void
 Model::diff_eqs()
 {
-    int i, j;
-    unsigned fl;
-    set_ex::const_iterator it1, it2, it3;
-    std::map<std::pair<int, int>, unsigned>::const_iterator itf;
-    ex x, r, e;
+    int i;
+    set_ex::const_iterator it;
+    vec_ex vm1, v0, vp1, shocks(m_shocks.begin(), m_shocks.end());
 
     if (m_static) return;
 
-    for (it1 = m_eqs.begin(), i = 1; it1 != m_eqs.end(); ++it1, ++i) {
-        e = *it1;
-        for (it2 = m_vars.begin(), j = 1; it2 != m_vars.end(); ++it2, ++j) {
-            itf = m_var_eq_map.find(std::pair<int, int>(i, j));
-            if (itf == m_var_eq_map.end()) continue;
-            fl = itf->second;
-            if (fl & LAG_M1) {
-                x = lag(*it2, -1);
-                r = diff(e, x);
-                r = ss(r);
-                if (r) {
-                    for (it3 = m_shocks.begin(); (it3 != m_shocks.end()) && (r); ++it3) {
-                        r = r.subst(ss(*it3), ex());
-                    }
-                }
-                if (r) m_Atm1.insert(std::pair<std::pair<int, int>, ex>(
-                            std::pair<int, int>(i, j), r));
-            }
-            if (fl & LAG_0) {
-                x = *it2;
-                r = diff(e, x);
-                r = ss(r);
-                if (r) {
-                    for (it3 = m_shocks.begin(); (it3 != m_shocks.end()) && (r); ++it3) {
-                        r = r.subst(ss(*it3), ex());
-                    }
-                }
-                if (r) m_At.insert(std::pair<std::pair<int, int>, ex>(
-                            std::pair<int, int>(i, j), r));
-            }
-            if (fl & LAG_P1) {
-                x = lag(*it2, 1);
-                r = diff(e, x);
-                r = ss(r);
-                if (r) {
-                    for (it3 = m_shocks.begin(); (it3 != m_shocks.end()) && (r); ++it3) {
-                        r = r.subst(ss(*it3), ex());
-                    }
-                }
-                if (r) m_Atp1.insert(std::pair<std::pair<int, int>, ex>(
-                            std::pair<int, int>(i, j), r));
-            }
-        }
-        for (it2 = m_shocks.begin(), j = 1; it2 != m_shocks.end(); ++it2, ++j) {
-            x = *it2;
-            r = diff(e, x);
-            r = ss(r);
-            if (r) {
-                for (it3 = m_shocks.begin(); (it3 != m_shocks.end()) && (r); ++it3) {
-                    r = r.subst(ss(*it3), ex());
-                }
-            }
-            if (r) m_Aeps.insert(std::pair<std::pair<int, int>, ex>(
-                        std::pair<int, int>(i, j), r));
-        }
+    map_ex_ex ssshocks;
+    for (it = m_shocks.begin(); it != m_shocks.end(); ++it) {
+        ssshocks.insert(std::make_pair(ss(*it), ex()));
+    }
+    for (it = m_vars.begin(); it != m_vars.end(); ++it) {
+        vm1.push_back(lag(*it, -1));
+        v0.push_back(*it);
+        vp1.push_back(lag(*it, 1));
+    }
+    // Positions do not depend on lag
+    map_ex_int pos = diff_pos(v0), spos = diff_pos(shocks);
+    std::vector<map_ex_ex> tdiffs(m_eq_tpls.size());
+    for (it = m_eqs.begin(), i = 1; it != m_eqs.end(); ++it, ++i) {
+        insert_diffs(m_Atm1, i, ss_noshocks(eq_diffs(*it, vm1, pos, tdiffs), ssshocks));
+        insert_diffs(m_At, i, ss_noshocks(eq_diffs(*it, v0, pos, tdiffs), ssshocks));
+        insert_diffs(m_Atp1, i, ss_noshocks(eq_diffs(*it, vp1, pos, tdiffs), ssshocks));
+        insert_diffs(m_Aeps, i, ss_noshocks(eq_diffs(*it, shocks, spos, tdiffs), ssshocks));
     }
 }
@@ -206,6 +206,24 @@ Model::write_log(std::ostream &logfile) const
         logfile << "\n";
     }
 
+    if (m_options[simplify]) {
+        logfile << "Simplification (size of equations in nodes):\n"
+                << tab << "in blocks: " << m_simpl_size[0] << " -> " << m_simpl_size[1] << "\n"
+                << tab << "after reduction: " << m_simpl_size[2] << " -> " << m_simpl_size[3]
+                << "\n\n";
+    }
+
+    if (m_red_skipped.size()) {
+        logfile << "Substitutions skipped in reduction, budget " << m_red_budget
+                << " (" << m_red_skipped.size() << "):\n";
+        map_ex_int::const_iterator itm;
+        for (itm = m_red_skipped.begin(), i = 1; itm != m_red_skipped.end(); ++itm, ++i) {
+            logfile << " (" << i << ")  " << itm->first.str(pflag)
+                    << ", growth of equations: " << itm->second << "\n";
+        }
+        logfile << "\n";
+    }
+
     if (!errors() && !warnings()) return;
     logfile << "\n" << errwarn << "\n";
     if (errors()) logfile << get_errs(true) << "\n";
@@ -1158,3 +1176,22 @@ Model::write() const
     if (m_options[output_latex]) write_latex();
 
 }
+
+
+
+std::vector<std::string>
+Model::outputs() const
+{
+    std::vector<std::string> res;
+#ifndef R_DLL
+    if (m_options[output_r])
+#endif /* R_DLL */
+        res.push_back(m_path + m_name + ".model.R");
+    if (m_options[output_logf]) res.push_back(m_path + m_name + ".model.log");
+    if (m_options[output_latex]) {
+        res.push_back(m_path + m_name + ".tex");
+        res.push_back(m_path + m_name + ".results.tex");
+        res.push_back(m_path + m_name + ".model.tex");
+    }
+    return res;
+}
@@ -0,0 +1,299 @@
+/****************************************************************************
+ * This file is a part of gEcon.                                             
+ *                                                                           
+ * (c) Chancellery of the Prime Minister of the Republic of Poland 2012-2015 
+ * (c) Grzegorz Klima, Karol Podemski, Kaja Retkiewicz-Wijtiwiak 2015-2016   
+ * License terms can be found in the file 'LICENCE'                          
+ *                                                                           
+ * Author: Grzegorz Klima                                                    
+ ***************************************************************************/
+
+
+/** \file compile_cache.cpp
+ * \brief On-disk cache of model outputs.
+ */
+
+#include <compile_cache.h>
+#include <gecon_info.h>
+#include <utils.h>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <utility>
+#include <cstdio>
+#include <cstdlib>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <utime.h>
+#include <unistd.h>
+#include <ctime>
+
+using symbolic::internal::num2str;
+
+
+namespace {
+
+// Default bound on size of cache (in MB)
+const double default_size = 64.;
+// Entry header
+const char *magic = "gEcon compile cache";
+// Entry file suffix
+const std::string suffix = ".gcache";
+// Temporary entry file suffix
+const std::string tmp_suffix = ".gcache.tmp";
+// Age (in seconds) after which temporary files are assumed to be left
+// by interrupted writes
+const double tmp_age = 3600.;
+
+
+// FNV-1a hash (64 bit) with a given offset basis
+unsigned long long
+fnv1a(const std::string &s, unsigned long long h)
+{
+    for (std::string::const_iterator it = s.begin(); it != s.end(); ++it) {
+        h ^= (unsigned char) *it;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+
+std::string
+hex(unsigned long long h)
+{
+    static const char digits[] = "0123456789abcdef";
+    std::string res(16, '0');
+    for (int i = 15; i >= 0; --i, h >>= 4) res[i] = digits[h & 15];
+    return res;
+}
+
+
+bool
+read_file(const std::string &fname, std::string &s)
+{
+    std::ifstream f(fname.c_str(), std::ios::in | std::ios::binary);
+    if (!f.good()) return false;
+    std::ostringstream ss;
+    ss << f.rdbuf();
+    if (f.bad()) return false;
+    s = ss.str();
+    return true;
+}
+
+
+bool
+write_file(const std::string &fname, const std::string &s)
+{
+    std::ofstream f(fname.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!f.good()) return false;
+    f.write(s.data(), s.size());
+    f.close();
+    return f.good();
+}
+
+
+// Read line (up to '\n') starting at pos
+bool
+get_line(const std::string &s, size_t &pos, std::string &line)
+{
+    size_t nl = s.find('\n', pos);
+    if (nl == std::string::npos) return false;
+    line = s.substr(pos, nl - pos);
+    pos = nl + 1;
+    return true;
+}
+
+
+// Read record (name, size, content) starting at pos
+bool
+get_record(const std::string &s, size_t &pos, std::string &name, std::string &cont)
+{
+    std::string len;
+    if (!get_line(s, pos, name) || !get_line(s, pos, len)) return false;
+    char *end;
+    unsigned long l = strtoul(len.c_str(), &end, 10);
+    if (len.empty() || *end || (l > s.size() - pos)) return false;
+    cont = s.substr(pos, l);
+    pos += l;
+    return true;
+}
+
+
+void
+put_record(std::string &s, const std::string &name, const std::string &cont)
+{
+    s += name + '\n' + num2str((unsigned) cont.size()) + '\n' + cont;
+}
+
+
+// Is record name a plain file name (restored files must stay in model path)?
+bool
+safe_name(const std::string &name)
+{
+    return (name.find_first_of("/\\") == std::string::npos)
+           && (name.find("..") == std::string::npos);
+}
+
+
+// Bound on size of cache (in bytes)
+double
+max_size()
+{
+    const char *s = getenv("GECON_CACHE_SIZE");
+    if (!s || !*s) return default_size * 1048576.;
+    char *end;
+    double mb = strtod(s, &end);
+    if (*end || (mb < 0.)) return default_size * 1048576.;
+    return mb * 1048576.;
+}
+
+
+// Does file name end with a given suffix?
+bool
+has_suffix(const std::string &fname, const std::string &suf)
+{
+    return (fname.size() > suf.size())
+           && !fname.compare(fname.size() - suf.size(), suf.size(), suf);
+}
+
+
+// Remove stale temporary files and least recently used entries until
+// the cache fits its bound
+void
+evict(const std::string &dir)
+{
+    DIR *d = opendir(dir.c_str());
+    if (!d) return;
+    std::vector<std::pair<time_t, std::pair<double, std::string> > > entries;
+    double total = 0.;
+    time_t now = time(0);
+    for (struct dirent *de = readdir(d); de; de = readdir(d)) {
+        std::string fname(de->d_name);
+        bool tmp = has_suffix(fname, tmp_suffix);
+        if (!tmp && !has_suffix(fname, suffix)) continue;
+        fname = dir + fname;
+        struct stat st;
+        if (stat(fname.c_str(), &st)) continue;
+        if (tmp) {
+            if (difftime(now, st.st_mtime) > tmp_age) remove(fname.c_str());
+            continue;
+        }
+        entries.push_back(std::make_pair(st.st_mtime, std::make_pair((double) st.st_size, fname)));
+        total += st.st_size;
+    }
+    closedir(d);
+    double bound = max_size();
+    if (total <= bound) return;
+    std::sort(entries.begin(), entries.end());
+    for (unsigned i = 0; (i < entries.size()) && (total > bound); ++i) {
+        if (!remove(entries[i].second.second.c_str())) total -= entries[i].second.first;
+    }
+}
+
+
+} /* namespace */
+
+
+
+std::string
+cache_dir()
+{
+    if (getenv("GECON_NO_CACHE")) return std::string();
+    const char *s = getenv("GECON_CACHE_DIR");
+    if (!s || !*s) return std::string();
+    std::string dir(s);
+    struct stat st;
+    if (stat(dir.c_str(), &st) || !(st.st_mode & S_IFDIR)) return std::string();
+    char last = dir[dir.size() - 1];
+    if ((last != '/') && (last != '\\')) dir += '/';
+    return dir;
+}
+
+
+
+std::string
+cache_key(const std::string &fname, const std::string &name, const std::string &opts,
+          std::string &mat)
+{
+    std::string s;
+    if (!read_file(fname, s)) return std::string();
+    // Outputs contain model file name, so it is a part of the key
+    s += '\0' + fname + '\0' + name + '\0' + opts + '\0' + gecon_ver_str();
+#ifdef R_DLL
+    s += std::string("\0R", 2);
+#endif /* R_DLL */
+    mat.swap(s);
+    // Two independent 64 bit hashes make a 128 bit key
+    return hex(fnv1a(mat, 14695981039346656037ULL)) + hex(fnv1a(mat, 3452663225145306617ULL));
+}
+
+
+
+bool
+cache_restore(const std::string &dir, const std::string &key,
+              const std::string &mat, const std::string &path,
+              std::vector<std::string> &warns)
+{
+    std::string entry = dir + key + suffix, s, line;
+    if (!read_file(entry, s)) return false;
+    size_t pos = 0;
+    if (!get_line(s, pos, line) || (line != magic)) return false;
+    // Key material is the first record (named with the key)
+    std::string name, cont;
+    if (!get_record(s, pos, name, cont) || (name != key) || (cont != mat)) return false;
+    // Warnings have empty names, files are named relative to model path
+    std::vector<std::string> w;
+    std::vector<std::pair<std::string, std::string> > files;
+    while (pos < s.size()) {
+        if (!get_record(s, pos, name, cont)) return false;
+        if (name.empty()) {
+            w.push_back(cont);
+        } else {
+            if (!safe_name(name)) return false;
+            files.push_back(std::make_pair(path + name, cont));
+        }
+    }
+    for (unsigned i = 0; i < files.size(); ++i) {
+        if (!write_file(files[i].first, files[i].second)) return false;
+    }
+    warns.swap(w);
+    // Mark entry as recently used
+    utime(entry.c_str(), 0);
+    return true;
+}
+
+
+
+void
+cache_store(const std::string &dir, const std::string &key,
+            const std::string &mat, const std::string &path,
+            const std::vector<std::string> &files,
+            const std::vector<std::string> &warns)
+{
+    std::string s = std::string(magic) + '\n', name, cont;
+    put_record(s, key, mat);
+    for (unsigned i = 0; i < warns.size(); ++i) {
+        put_record(s, std::string(), warns[i]);
+    }
+    for (unsigned i = 0; i < files.size(); ++i) {
+        name = files[i].substr(path.size());
+        if (!safe_name(name) || !read_file(files[i], cont)) return;
+        put_record(s, name, cont);
+    }
+    // Entry is written to a temporary file (unique to the process) first,
+    // so that an interrupted or concurrent write never leaves a truncated
+    // entry
+    std::string entry = dir + key + suffix,
+                tmp = dir + key + '.' + num2str((int) getpid()) + tmp_suffix;
+    if (!write_file(tmp, s)) {
+        remove(tmp.c_str());
+        return;
+    }
+    remove(entry.c_str());
+    if (rename(tmp.c_str(), entry.c_str())) {
+        remove(tmp.c_str());
+        return;
+    }
+    evict(dir);
+}
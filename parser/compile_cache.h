@@ -0,0 +1,56 @@
+/****************************************************************************
+ * This file is a part of gEcon.                                             
+ *                                                                           
+ * (c) Chancellery of the Prime Minister of the Republic of Poland 2012-2015 
+ * (c) Grzegorz Klima, Karol Podemski, Kaja Retkiewicz-Wijtiwiak 2015-2016   
+ * License terms can be found in the file 'LICENCE'                          
+ *                                                                           
+ * Author: Grzegorz Klima                                                    
+ ***************************************************************************/
+
+/** \file compile_cache.h
+ * \brief On-disk cache of model outputs.
+ */
+
+#include <string>
+#include <vector>
+
+#ifndef PARSER_COMPILE_CACHE_H
+
+#define PARSER_COMPILE_CACHE_H
+
+/// Compile cache is enabled by setting environment variable GECON_CACHE_DIR
+/// to an existing directory. Entries are keyed by a hash of the model file
+/// content and name, model name, default options (set in the environment,
+/// others are set in the model file) and gEcon version; an entry holds the
+/// key material itself (compared byte for byte on restore, so that hash
+/// collisions never return outputs of another model), all files written
+/// by the model and warnings reported when it was parsed.
+/// Setting environment variable GECON_NO_CACHE bypasses the cache (nothing
+/// is restored or stored). Temporary files left by interrupted writes are
+/// removed after an hour.
+/// Total size of entries is bounded by GECON_CACHE_SIZE (in megabytes,
+/// 64 by default), least recently used entries are removed first.
+
+/// Cache directory (empty if cache is disabled)
+std::string cache_dir();
+
+/// Cache key of a model, key material (hashed into key) is returned in mat
+std::string cache_key(const std::string &fname, const std::string &name,
+                      const std::string &opts, std::string &mat);
+
+/// Restore files (in path) from cache entry, returns false if there is no
+/// valid entry for key material mat. Warnings stored with the entry
+/// are returned in warns.
+bool cache_restore(const std::string &dir, const std::string &key,
+                   const std::string &mat, const std::string &path,
+                   std::vector<std::string> &warns);
+
+/// Store files (full names, in path) and warnings in cache.
+void cache_store(const std::string &dir, const std::string &key,
+                 const std::string &mat, const std::string &path,
+                 const std::vector<std::string> &files,
+                 const std::vector<std::string> &warns);
+
+
+#endif /* PARSER_COMPILE_CACHE_H */
@@ -251,10 +251,10 @@ static  gEconParserImplTraits::BitsetListType FOLLOW_EOF_in_model97( FOLLOW_EOF_
 static	ANTLR_BITWORD FOLLOW_OPTS_in_opts115_bits[]	= { ANTLR_UINT64_LIT(0x0004000000000000) };
 static  gEconParserImplTraits::BitsetListType FOLLOW_OPTS_in_opts115( FOLLOW_OPTS_in_opts115_bits, 1 );
 /** Bitset defining follow set for error recovery in rule state: gEconParser  */
-static	ANTLR_BITWORD FOLLOW_LBRACE_in_opts117_bits[]	= { ANTLR_UINT64_LIT(0x8000000000000400), ANTLR_UINT64_LIT(0x0000000008000000) };
+static	ANTLR_BITWORD FOLLOW_LBRACE_in_opts117_bits[]	= { ANTLR_UINT64_LIT(0x8000020000000400), ANTLR_UINT64_LIT(0x0000000008000000) };
 static  gEconParserImplTraits::BitsetListType FOLLOW_LBRACE_in_opts117( FOLLOW_LBRACE_in_opts117_bits, 2 );
 /** Bitset defining follow set for error recovery in rule state: gEconParser  */
-static	ANTLR_BITWORD FOLLOW_opt_in_opts120_bits[]	= { ANTLR_UINT64_LIT(0x8000000000000400), ANTLR_UINT64_LIT(0x0000000008000100) };
+static	ANTLR_BITWORD FOLLOW_opt_in_opts120_bits[]	= { ANTLR_UINT64_LIT(0x8000020000000400), ANTLR_UINT64_LIT(0x0000000008000100) };
 static  gEconParserImplTraits::BitsetListType FOLLOW_opt_in_opts120( FOLLOW_opt_in_opts120_bits, 2 );
 /** Bitset defining follow set for error recovery in rule state: gEconParser  */
 static	ANTLR_BITWORD FOLLOW_RBRACE_in_opts124_bits[]	= { ANTLR_UINT64_LIT(0x0000000000000002), ANTLR_UINT64_LIT(0x0000000000000800) };
@@ -293,6 +293,21 @@ static  gEconParserImplTraits::BitsetListType FOLLOW_atom_bool_in_opt182( FOLLOW
 static	ANTLR_BITWORD FOLLOW_SEMI_in_opt186_bits[]	= { ANTLR_UINT64_LIT(0x0000000000000002) };
 static  gEconParserImplTraits::BitsetListType FOLLOW_SEMI_in_opt186( FOLLOW_SEMI_in_opt186_bits, 1 );
 /** Bitset defining follow set for error recovery in rule state: gEconParser  */
+static	ANTLR_BITWORD FOLLOW_ID_in_opt194_bits[]	= { ANTLR_UINT64_LIT(0x0000001000000000) };
+static  gEconParserImplTraits::BitsetListType FOLLOW_ID_in_opt194( FOLLOW_ID_in_opt194_bits, 1 );
+/** Bitset defining follow set for error recovery in rule state: gEconParser  */
+static	ANTLR_BITWORD FOLLOW_EQ_in_opt196_bits[]	= { ANTLR_UINT64_LIT(0x0000200000002800), ANTLR_UINT64_LIT(0x0000000020000000) };
+static  gEconParserImplTraits::BitsetListType FOLLOW_EQ_in_opt196( FOLLOW_EQ_in_opt196_bits, 2 );
+/** Bitset defining follow set for error recovery in rule state: gEconParser  */
+static	ANTLR_BITWORD FOLLOW_atom_int_in_opt202_bits[]	= { ANTLR_UINT64_LIT(0x0000000000000000), ANTLR_UINT64_LIT(0x0000000000000800) };
+static  gEconParserImplTraits::BitsetListType FOLLOW_atom_int_in_opt202( FOLLOW_atom_int_in_opt202_bits, 2 );
+/** Bitset defining follow set for error recovery in rule state: gEconParser  */
+static	ANTLR_BITWORD FOLLOW_atom_bool_in_opt210_bits[]	= { ANTLR_UINT64_LIT(0x0000000000000000), ANTLR_UINT64_LIT(0x0000000000000800) };
+static  gEconParserImplTraits::BitsetListType FOLLOW_atom_bool_in_opt210( FOLLOW_atom_bool_in_opt210_bits, 2 );
+/** Bitset defining follow set for error recovery in rule state: gEconParser  */
+static	ANTLR_BITWORD FOLLOW_SEMI_in_opt206_bits[]	= { ANTLR_UINT64_LIT(0x0000000000000002) };
+static  gEconParserImplTraits::BitsetListType FOLLOW_SEMI_in_opt206( FOLLOW_SEMI_in_opt206_bits, 1 );
+/** Bitset defining follow set for error recovery in rule state: gEconParser  */
 static	ANTLR_BITWORD FOLLOW_LOGF_in_opt_output203_bits[]	= { ANTLR_UINT64_LIT(0x0000001000000000) };
 static  gEconParserImplTraits::BitsetListType FOLLOW_LOGF_in_opt_output203( FOLLOW_LOGF_in_opt_output203_bits, 1 );
 /** Bitset defining follow set for error recovery in rule state: gEconParser  */
@@ -2303,6 +2318,7 @@ gEconParser::opts()
             	switch ( this->LA(1) )
             	{
             	case BACKWARDCOMP:
+            	case ID:
             	case OUTPUT:
             	case VERBOSE:
             		{
@@ -2405,7 +2421,7 @@ gEconParser::opts()
 
 /**
  * $ANTLR start opt
- * ../gEcon_CURRENT/src/parser/grammar/gEcon.g:79:1: opt : ( OUTPUT opt_output | VERBOSE EQ b= atom_bool SEMI | BACKWARDCOMP EQ b= atom_bool SEMI );
+ * ../gEcon_CURRENT/src/parser/grammar/gEcon.g:79:1: opt : ( OUTPUT opt_output | VERBOSE EQ b= atom_bool SEMI | BACKWARDCOMP EQ b= atom_bool SEMI | ID EQ (n= atom_int |b= atom_bool ) SEMI );
  */
 void
 gEconParser::opt()
@@ -2413,21 +2429,26 @@ gEconParser::opt()
         gEconParserImplTraits::RuleReturnValueType _antlr_rule_exit(this);
       
 
+    const CommonTokenType*    ID56;
     bool b;
     typedef	bool RETURN_TYPE_b;
 
+    int n;
+    typedef	int RETURN_TYPE_n;
+
     /* Initialize rule variables
      */
 
+    ID56       = NULL;
 
  
     {
         {
-            //  ../gEcon_CURRENT/src/parser/grammar/gEcon.g:80:5: ( OUTPUT opt_output | VERBOSE EQ b= atom_bool SEMI | BACKWARDCOMP EQ b= atom_bool SEMI )
+            //  ../gEcon_CURRENT/src/parser/grammar/gEcon.g:80:5: ( OUTPUT opt_output | VERBOSE EQ b= atom_bool SEMI | BACKWARDCOMP EQ b= atom_bool SEMI | ID EQ (n= atom_int |b= atom_bool ) SEMI )
 
             ANTLR_UINT32 alt7;
 
-            alt7=3;
+            alt7=4;
 
             switch ( this->LA(1) )
             {
@@ -2446,6 +2467,11 @@ gEconParser::opt()
             		alt7=3;
             	}
                 break;
+            case ID:
+            	{
+            		alt7=4;
+            	}
+                break;
 
             default:
                 ExceptionBaseType* ex = new ANTLR_Exception< gEconParserImplTraits, NO_VIABLE_ALT_EXCEPTION, StreamType>( this->get_rec(), "" );
@@ -2561,6 +2587,106 @@ gEconParser::opt()
         	        }
 
 
+        	    }
+        	    break;
+        	case 4:
+        	    // ../gEcon_CURRENT/src/parser/grammar/gEcon.g:83:7: ID EQ (n= atom_int |b= atom_bool ) SEMI
+        	    {
+        	        ID56 =  this->matchToken(ID, &FOLLOW_ID_in_opt194);
+        	        if  (this->hasException())
+        	        {
+        	            goto ruleoptEx;
+        	        }
+
+
+        	         this->matchToken(EQ, &FOLLOW_EQ_in_opt196);
+        	        if  (this->hasException())
+        	        {
+        	            goto ruleoptEx;
+        	        }
+
+
+        	        // ../gEcon_CURRENT/src/parser/grammar/gEcon.g:83:14: (n= atom_int |b= atom_bool )
+        	        {
+        	            int alt83=2;
+        	            switch ( this->LA(1) )
+        	            {
+        	            case INT:
+        	            case ZERO:
+        	            	{
+        	            		alt83=1;
+        	            	}
+        	                break;
+        	            case BFALSE:
+        	            case BTRUE:
+        	            	{
+        	            		alt83=2;
+        	            	}
+        	                break;
+
+        	            default:
+        	                ExceptionBaseType* ex = new ANTLR_Exception< gEconParserImplTraits, NO_VIABLE_ALT_EXCEPTION, StreamType>( this->get_rec(), "" );
+        	                ex->set_decisionNum( 83 );
+        	                ex->set_state( 0 );
+
+
+        	                goto ruleoptEx;
+
+        	            }
+
+        	            switch (alt83)
+        	            {
+        	        	case 1:
+        	        	    // ../gEcon_CURRENT/src/parser/grammar/gEcon.g:83:15: n= atom_int
+        	        	    {
+        	        	        this->followPush(FOLLOW_atom_int_in_opt202);
+        	        	        n=atom_int();
+
+        	        	        this->followPop();
+        	        	        if  (this->hasException())
+        	        	        {
+        	        	            goto ruleoptEx;
+        	        	        }
+
+
+        	        	        {
+        	        	             model_obj.set_option((ID56->getText()), n, (ID56->get_line())); 
+        	        	        }
+
+
+        	        	    }
+        	        	    break;
+        	        	case 2:
+        	        	    // ../gEcon_CURRENT/src/parser/grammar/gEcon.g:84:15: b= atom_bool
+        	        	    {
+        	        	        this->followPush(FOLLOW_atom_bool_in_opt210);
+        	        	        b=atom_bool();
+
+        	        	        this->followPop();
+        	        	        if  (this->hasException())
+        	        	        {
+        	        	            goto ruleoptEx;
+        	        	        }
+
+
+        	        	        {
+        	        	             model_obj.set_option((ID56->getText()), b, (ID56->get_line())); 
+        	        	        }
+
+
+        	        	    }
+        	        	    break;
+
+        	            }
+        	        }
+
+        	         this->matchToken(SEMI, &FOLLOW_SEMI_in_opt206);
+        	        if  (this->hasException())
+        	        {
+        	            goto ruleoptEx;
+        	        }
+
+
         	    }
         	    break;
 
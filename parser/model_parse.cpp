@@ -21,6 +21,7 @@
 #include <Rcpp.h>
 #endif /* R_DLL */
 #include <utils.h>
+#include <compile_cache.h>
 #include <gecon_info.h>
 #include <gecon_tokens.h>
 #include "gEconLexer.hpp"
@@ -32,6 +33,8 @@ using namespace parser;
 
 std::vector<std::string> errors;
 Model model_obj;
+// Warnings reported while parsing current model
+std::vector<std::string> reported_warns;
 
 
 void
@@ -49,6 +52,7 @@ report_errors(const std::string &mes)
 void
 report_warns(const std::string &mes)
 {
+    reported_warns.push_back(mes);
 #ifdef R_DLL
     warning(('\n' + mes).c_str());
 #else /* R_DLL */
@@ -98,6 +102,7 @@ model_parse(const char *fname)
 {
     unsigned char **tnames = mk_tnames();
     model_obj.clear();
+    reported_warns.clear();
     std::string name(fname), mod_name;
 
     // write_info(gecon_hello_str());
@@ -107,6 +112,22 @@ model_parse(const char *fname)
     }
     model_obj.set_name(mod_name);
 
+    // Outputs of a model file with unchanged content are restored from
+    // compile cache (if enabled). Options are set in the model file or
+    // taken from the environment when model is created, so file content
+    // and default options determine the effective ones.
+    std::string cdir = cache_dir(), ckey, cmat;
+    if (cdir.size()) ckey = cache_key(name, model_obj.get_name(), model_obj.options_str(), cmat);
+    if (ckey.size()) {
+        std::vector<std::string> warns;
+        if (cache_restore(cdir, ckey, cmat, model_obj.get_path(), warns)) {
+            for (unsigned i = 0; i < warns.size(); ++i) report_warns(warns[i]);
+            free_tnames(tnames);
+            model_obj.clear();
+            return;
+        }
+    }
+
     ANTLR_UINT8 *fName;
     fName = (ANTLR_UINT8*) fname;
 
@@ -204,5 +225,8 @@ report it (with the .gcn file that caused this message) to " + gecon_bug_str()))
 #endif
     
     model_obj.write();
+    if (ckey.size()) {
+        cache_store(cdir, ckey, cmat, model_obj.get_path(), model_obj.outputs(), reported_warns);
+    }
     model_obj.clear();
 }
@@ -55,6 +55,7 @@ compare(const ptr_base &a, const ptr_base &b)
 {
     int c;
     unsigned t;
+    if (a.get() == b.get()) return 0;
     if ((c = compareT(t = a->type(), b->type()))) return c;
 #ifdef EXPAND_CASE
 #undef EXPAND_CASE
@@ -85,6 +86,17 @@ compare(const ptr_base &a, const ptr_base &b)
 }
 
 
+/// Equality test; trees with different hash values are rejected in O(1).
+inline
+bool
+equal(const ptr_base &a, const ptr_base &b)
+{
+    if (a.get() == b.get()) return true;
+    if (a->hash() != b->hash()) return false;
+    return !compare(a, b);
+}
+
+
 } /* namespace internal */
 } /* namespace symbolic */
 
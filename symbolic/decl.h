@@ -44,6 +44,7 @@ typedef std::vector<ex> vec_ex;
 typedef std::set<ex, less_ex> set_ex;
 typedef std::map<ex, ex, less_ex> map_ex_ex;
 typedef std::map<ex, int, less_ex> map_ex_int;
+typedef std::map<int, ex> map_int_ex;
 typedef std::map<ex, std::string, less_ex> map_ex_str;
 typedef std::map<std::string, std::string> map_str_str;
 
@@ -70,6 +71,10 @@ class ex_sum;
 class ex_prod;
 class ex_idx;
 
+/// Renaming of indices: pairs of index ids and their new values,
+/// later pairs take precedence.
+typedef std::vector<std::pair<unsigned, int> > idx_ren;
+
 
 /// Expression types
 enum ex_type {
@@ -81,6 +86,7 @@ enum ex_type {
     SPOW1   =      0x8,
     HAST    =     0x10,
     HASIDX  =     0x20,
+    RAW     =     0x40,
     // atomic expressions
     NUM     =    0x100,
     DELTA   =    0x200,
@@ -134,6 +140,16 @@ enum search_flag {
 };
 
 
+/// Occurrence flags (lags with which a symbol appears)
+enum occ_flag {
+    OCC_LAG_M1  =  0x1,
+    OCC_LAG_0   =  0x2,
+    OCC_LAG_P1  =  0x4,
+    OCC_LAG_SS  =  0x8,
+    OCC_LAG_OTH = 0x10
+};
+
+
 } /* namespace internal */
 } /* namespace symbolic */
 
@@ -0,0 +1,35 @@
+/*****************************************************************************
+ * This file is a part of gEcon.                                             *
+ *                                                                           *
+ * (c) Chancellery of the Prime Minister of the Republic of Poland 2012-2015 *
+ * (c) Grzegorz Klima, Karol Podemski, Kaja Retkiewicz-Wijtiwiak 2015-2016   *
+ * License terms can be found in the file 'LICENCE'                          *
+ *                                                                           *
+ * Author: Grzegorz Klima                                                    *
+ *****************************************************************************/
+
+/** \file diff_cache.cpp
+ * \brief Memo table for symbolic derivatives.
+ */
+
+#include <diff_cache.h>
+#include <ex_base.h>
+
+
+using namespace symbolic::internal;
+
+
+
+ptr_base
+diff_cache::diff(const ptr_base &e, const ptr_base &v)
+{
+    // Atoms are cheaper to differentiate than to look up
+    if (e->type() < FUN) return e->diff(v);
+
+    const ptr_base *r = m_tab.find(e, 0, v, 0);
+    if (r) return *r;
+    // Differentiation recurses into the cache, entry is stored afterwards
+    ptr_base d = e->diff(v);
+    m_tab.insert(e, 0, v, 0, d);
+    return d;
+}
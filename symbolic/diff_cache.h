@@ -0,0 +1,75 @@
+/*****************************************************************************
+ * This file is a part of gEcon.                                             *
+ *                                                                           *
+ * (c) Chancellery of the Prime Minister of the Republic of Poland 2012-2015 *
+ * (c) Grzegorz Klima, Karol Podemski, Kaja Retkiewicz-Wijtiwiak 2015-2016   *
+ * License terms can be found in the file 'LICENCE'                          *
+ *                                                                           *
+ * Author: Grzegorz Klima                                                    *
+ *****************************************************************************/
+
+/** \file diff_cache.h
+ * \brief Memo table for symbolic derivatives.
+ */
+
+#ifndef SYMBOLIC_DIFF_CACHE_H
+
+#define SYMBOLIC_DIFF_CACHE_H
+
+#include <decl.h>
+#include <ptr_base.h>
+#include <memo_table.h>
+#include <string>
+
+
+namespace symbolic {
+namespace internal {
+
+
+/// Singleton class memoizing derivatives of compound expressions
+/// (entries are keyed by the expression and the variable, see memo_table).
+class diff_cache
+{
+  public:
+    /// Derivative of e wrt v (e->diff(v), looked up in the cache
+    /// for compound expressions).
+    ptr_base diff(const ptr_base &e, const ptr_base &v);
+    /// Drop all entries and reset statistics.
+    void clear() { m_tab.clear(); }
+    /// Number of entries
+    unsigned size() const { return m_tab.size(); }
+    /// Cache statistics (empty if cache was not used)
+    std::string stats() const { return m_tab.stats(); }
+    /// Get instance
+    static diff_cache& get_instance()
+    {
+        // Never destroyed, like the unique table
+        static diff_cache *instance = new diff_cache;
+        return *instance;
+    }
+
+  private:
+    // Memo table
+    memo_table m_tab;
+    // Constructor is private
+    diff_cache() { ; }
+    // Private, too. Not implemented.
+    diff_cache(diff_cache const& copy);
+    diff_cache& operator=(diff_cache const& copy);
+
+}; /* class diff_cache */
+
+
+/// Derivative of e wrt v through the cache
+inline
+ptr_base
+cached_diff(const ptr_base &e, const ptr_base &v)
+{
+    return diff_cache::get_instance().diff(e, v);
+}
+
+
+} /* namespace internal */
+} /* namespace symbolic */
+
+#endif /* SYMBOLIC_DIFF_CACHE_H */
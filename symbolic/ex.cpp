@@ -22,6 +22,7 @@
 #include <ex_sum.h>
 #include <ex_idx.h>
 #include <ops.h>
+#include <expansion_cache.h>
 #include <cmp.h>
 #include <error.h>
 #ifdef R_DLL
@@ -133,14 +134,14 @@ ex::operator=(const ex &rhs)
 bool
 ex::operator==(const ex &rhs)
 {
-    return compare(m_ptr, rhs.m_ptr) ? false : true;
+    return equal(m_ptr, rhs.m_ptr);
 }
 
 
 bool
 ex::operator!=(const ex &rhs)
 {
-    return compare(m_ptr, rhs.m_ptr) ? true : false;
+    return !equal(m_ptr, rhs.m_ptr);
 }
 
 
@@ -165,6 +166,13 @@ ex::has_Es() const
 }
 
 
+bool
+ex::has_prods() const
+{
+    return symbolic::internal::has_prods(m_ptr);
+}
+
+
 ex
 ex::subst(const ex &what, const ex &with, bool all_leads_lags) const
 {
@@ -172,6 +180,17 @@ ex::subst(const ex &what, const ex &with, bool all_leads_lags) const
 }
 
 
+ex
+ex::subst(const map_ex_ex &m, bool all_leads_lags) const
+{
+    subst_list sl;
+    sl.reserve(m.size());
+    for (map_ex_ex::const_iterator it = m.begin(); it != m.end(); ++it)
+        sl.push_back(std::make_pair(it->first.m_ptr, it->second.m_ptr));
+    return ex(symbolic::internal::subst(m_ptr, sl, all_leads_lags));
+}
+
+
 ex
 ex::substidx(const std::string &what, const std::string &with, bool fix) const
 {
@@ -318,6 +337,124 @@ symbolic::diff(const ex &exp, const ex &var)
 }
 
 
+vec_ex
+symbolic::diff_each(const ex &exp, const vec_ex &vars)
+{
+    // One traversal finds the variables that occur, only those are
+    // differentiated, each by its own walk (the derivative cache is keyed
+    // on node and variable, work is not shared between variables).
+    // Variables with free indices
+    // match symbols with other indices (e.g. D<s> and D<j> bound in a sum),
+    // for them the search is left to mk_diff.
+    map_ex_int occ;
+    collect_occ(exp.m_ptr, occ);
+    vec_ex res(vars.size());
+    for (unsigned i = 0; i < vars.size(); ++i) {
+        const ptr_base &v = vars[i].m_ptr;
+        unsigned t = v->type(), fl = OCC_LAG_0;
+        ex key = vars[i];
+        if (t == VART) {
+            fl = occ_lag_flag(v.get<ex_vart>()->get_lag());
+            key = ex(v.get<ex_vart>()->copy0());
+        } else if (t == VARTIDX) {
+            fl = occ_lag_flag(v.get<ex_vartidx>()->get_lag());
+            key = ex(v.get<ex_vartidx>()->copy0());
+        }
+        if (((t == VART) || (t == VARTIDX) || (t == SYMB) || (t == SYMBIDX))
+            && !(v->flag() & HASIDX)) {
+            map_ex_int::const_iterator it = occ.find(key);
+            if (it == occ.end()) continue;
+            if (!(it->second & (fl | OCC_LAG_OTH))) continue;
+        }
+        res[i] = ex(mk_diff(exp.m_ptr, v));
+    }
+    return res;
+}
+
+
+map_ex_int
+symbolic::diff_pos(const vec_ex &vars)
+{
+    map_ex_int res;
+    for (unsigned i = 0; i < vars.size(); ++i) {
+        const ptr_base &v = vars[i].m_ptr;
+        unsigned t = v->type();
+        ex key = vars[i];
+        if (t == VART) {
+            key = ex(v.get<ex_vart>()->copy0());
+        } else if (t == VARTIDX) {
+            key = ex(v.get<ex_vartidx>()->copy0());
+        } else if ((t != SYMB) && (t != SYMBIDX)) INTERNAL_ERROR
+        if (v->flag() & HASIDX) INTERNAL_ERROR
+        if (!res.insert(std::pair<ex, int>(key, i)).second) INTERNAL_ERROR
+    }
+    return res;
+}
+
+
+map_int_ex
+symbolic::diff_each(const ex &exp, const vec_ex &vars, const map_ex_int &pos)
+{
+    // Work is proportional to the number of variables in expression,
+    // not to the length of the variable list.
+    map_ex_int occ;
+    collect_occ(exp.m_ptr, occ);
+    map_int_ex res;
+    map_ex_int::const_iterator it, itp;
+    for (it = occ.begin(); it != occ.end(); ++it) {
+        itp = pos.find(it->first);
+        if (itp == pos.end()) continue;
+        const ptr_base &v = vars[itp->second].m_ptr;
+        unsigned t = v->type(), fl = OCC_LAG_0;
+        if (t == VART) {
+            fl = occ_lag_flag(v.get<ex_vart>()->get_lag());
+        } else if (t == VARTIDX) {
+            fl = occ_lag_flag(v.get<ex_vartidx>()->get_lag());
+        }
+        if (!(it->second & (fl | OCC_LAG_OTH))) continue;
+        res.insert(std::pair<int, ex>(itp->second, ex(mk_diff(exp.m_ptr, v))));
+    }
+    return res;
+}
+
+
+map_int_ex
+symbolic::diff_each(const ex &exp, const ex &tpl, const idx_ren &iv,
+                   const vec_ex &vars, const map_ex_int &pos, map_ex_ex &tdiffs)
+{
+    // Occurrences are checked in the element, derivative w.r.t. variable
+    // with free indices is taken on the template; values of template
+    // and variable indices turn Kronecker deltas into 0 / 1 and sums are
+    // expanded as in the element itself.
+    map_ex_int occ;
+    collect_occ(exp.m_ptr, occ);
+    map_int_ex res;
+    map_ex_int::const_iterator it, itp;
+    inst_cache cache;
+    for (it = occ.begin(); it != occ.end(); ++it) {
+        itp = pos.find(it->first);
+        if (itp == pos.end()) continue;
+        const ptr_base &v = vars[itp->second].m_ptr;
+        unsigned t = v->type(), fl = OCC_LAG_0;
+        if (t == VART) {
+            fl = occ_lag_flag(v.get<ex_vart>()->get_lag());
+        } else if (t == VARTIDX) {
+            fl = occ_lag_flag(v.get<ex_vartidx>()->get_lag());
+        }
+        if (!(it->second & (fl | OCC_LAG_OTH))) continue;
+        idx_ren viv(iv);
+        ex fv(free_idx(v, viv));
+        map_ex_ex::iterator itd = tdiffs.find(fv);
+        if (itd == tdiffs.end()) {
+            itd = tdiffs.insert(std::pair<ex, ex>(fv, ex(mk_diff(tpl.m_ptr, fv.m_ptr)))).first;
+        }
+        res.insert(std::pair<int, ex>(itp->second,
+                                      ex(instidx(itd->second.m_ptr, viv, iv.size(), cache))));
+    }
+    return res;
+}
+
+
 ex
 symbolic::append_name(const ex &e, const std::string &s)
 {
@@ -378,30 +515,122 @@ vec_ex
 symbolic::expand(const ex &e)
 {
     vec_ex res;
-    unsigned t = e.m_ptr->type();
-    if (t != IDX) {
-        res.push_back(ex(symbolic::internal::expandsp(e.m_ptr)));
+    // Index levels
+    std::vector<idx_ex> lev;
+    ptr_base ee = e.m_ptr;
+    while (ee->type() == IDX) {
+        const ex_idx *pt = ee.get<ex_idx>();
+        lev.push_back(pt->get_ie());
+        ee = pt->get_e();
+    }
+    if (lev.empty()) {
+        res.push_back(ex(symbolic::internal::expandsp(ee)));
         return res;
     }
-    const ex_idx *pt = e.m_ptr.get<ex_idx>();
-    idx_ex ie = pt->get_ie();
-    ptr_base ee = pt->get_e();
-    if (ie.m_excl_id > 0)
-        USER_ERROR("excluded index not evalued (substituted for) in idx_ex::evalidx")
-    res.reserve(ie.m_set->size());
-    idx_set_impl::const_iterator it;
-    for (it = ie.m_set->begin(); it != ie.m_set->end(); ++it) {
-        if (-ie.m_excl_id != (int) *it) {
-            vec_ex res0 = expand(ex(substidx(ee, ie.m_id, -(int)*it)));
-            for (unsigned j = 0; j < res0.size(); ++j) {
-                res.push_back(res0[j]);
-            }
+    // Indexed expressions are expanded once and shared by all phases
+    expansion_cache &ec = expansion_cache::get_instance();
+    if (ec.find(e.m_ptr, res)) return res;
+    // Walk the Cartesian product of index sets; outer indices are
+    // substituted once per value, the innermost one while expanding sums
+    // and products in a single pass over the (partially substituted) template
+    unsigned i = 0, j, n = lev.size();
+    std::vector<idx_ex> cur(n);
+    std::vector<idx_set_impl::const_iterator> it(n), ite(n);
+    std::vector<ptr_base> tpl(n, ee);
+    idx_ren iv(1);
+    inst_cache cache;
+    bool start = true;
+    // Templates are substituted with deferred canonicalization, elements
+    // are built canonical by instidx
+    deferred_canon dc(deferred_phases());
+    for (;;) {
+        if (start) {
+            // Exclusions may refer to outer indices
+            cur[i] = lev[i];
+            for (j = 0; j < i; ++j) cur[i] = cur[i].substidx(cur[j].m_id, -(int) *it[j]);
+            if (cur[i].m_excl_id > 0)
+                USER_ERROR("excluded index not evalued (substituted for) in idx_ex::evalidx")
+            it[i] = cur[i].m_set->begin();
+            ite[i] = cur[i].m_set->end();
+        } else {
+            ++it[i];
+        }
+        while ((it[i] != ite[i]) && (-cur[i].m_excl_id == (int) *it[i])) ++it[i];
+        if (it[i] == ite[i]) {
+            if (!i) break;
+            --i;
+            start = false;
+            continue;
+        }
+        if (i + 1 < n) {
+            tpl[i + 1] = substidx(tpl[i], cur[i].m_id, -(int) *it[i]);
+            ++i;
+            start = true;
+        } else {
+            iv[0] = std::pair<unsigned, int>(cur[i].m_id, -(int) *it[i]);
+            deferred_canon eager(false);
+            res.push_back(ex(instidx(tpl[i], iv, 0, cache)));
+            start = false;
         }
     }
+    ec.insert(e.m_ptr, res);
     return res;
 }
 
 
+ex
+symbolic::expand_idx(const ex &e, std::vector<idx_ren> &values)
+{
+    std::vector<idx_ex> lev;
+    ptr_base ee = e.m_ptr;
+    while (ee->type() == IDX) {
+        const ex_idx *pt = ee.get<ex_idx>();
+        lev.push_back(pt->get_ie());
+        ee = pt->get_e();
+    }
+    values.clear();
+    if (lev.empty()) {
+        values.push_back(idx_ren());
+        return e;
+    }
+    // Walk the Cartesian product of index sets in the order of expand
+    unsigned i = 0, j, n = lev.size();
+    std::vector<idx_ex> cur(n);
+    std::vector<idx_set_impl::const_iterator> it(n), ite(n);
+    idx_ren iv(n);
+    bool start = true;
+    for (;;) {
+        if (start) {
+            // Exclusions may refer to outer indices
+            cur[i] = lev[i];
+            for (j = 0; j < i; ++j) cur[i] = cur[i].substidx(iv[j].first, iv[j].second);
+            if (cur[i].m_excl_id > 0)
+                USER_ERROR("excluded index not evalued (substituted for) in expand_idx")
+            it[i] = cur[i].m_set->begin();
+            ite[i] = cur[i].m_set->end();
+        } else {
+            ++it[i];
+        }
+        while ((it[i] != ite[i]) && (-cur[i].m_excl_id == (int) *it[i])) ++it[i];
+        if (it[i] == ite[i]) {
+            if (!i) break;
+            --i;
+            start = false;
+            continue;
+        }
+        iv[i] = std::pair<unsigned, int>(cur[i].m_id, -(int) *it[i]);
+        if (i + 1 < n) {
+            ++i;
+            start = true;
+        } else {
+            values.push_back(iv);
+            start = false;
+        }
+    }
+    return ex(ee);
+}
+
+
 ex
 symbolic::drop_Es(const ex &e)
 {
@@ -409,6 +638,21 @@ symbolic::drop_Es(const ex &e)
 }
 
 
+ex
+symbolic::canon(const ex &e)
+{
+    return ex(internal::canon(e.m_ptr));
+}
+
+
+
+ex
+symbolic::simplify(const ex &e)
+{
+    return ex(internal::simplify(e.m_ptr));
+}
+
+
 
 void
 symbolic::find_Es(const ex &e, set_ex &sex)
@@ -439,6 +683,20 @@ symbolic::collect_lags(const ex &e, map_ex_int &map)
 }
 
 
+void
+symbolic::collect_occ(const ex &e, map_ex_int &occ)
+{
+    collect_occ(e.m_ptr, occ);
+}
+
+
+unsigned
+symbolic::cost(const ex &e)
+{
+    return cost(e.m_ptr);
+}
+
+
 void
 symbolic::collect_idx(const ex &e, std::set<unsigned> &iset)
 {
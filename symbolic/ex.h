@@ -71,20 +71,33 @@ class ex {
     ex(const idx_ex &ie, const ex &e);
     /// Constructor from ptr_base
     explicit ex(const internal::ptr_base &p) : m_ptr(p) { ; }
+    /// Constructor from temporary ptr_base
+    explicit ex(internal::ptr_base &&p) : m_ptr(std::move(p)) { ; }
+    /// Copy constructor
+    ex(const ex &e) : m_ptr(e.m_ptr) { ; }
+    /// Move constructor
+    ex(ex &&e) noexcept : m_ptr(std::move(e.m_ptr)) { ; }
     /// Destructor
     ~ex() { ; }
 
     /// Assignment
     ex& operator=(const ex &rhs);
+    /// Move assignment
+    ex& operator=(ex &&rhs) noexcept { m_ptr = std::move(rhs.m_ptr); return *this; }
 
     /// Return new expression constructed by substitution.
     ex subst(const ex &what, const ex &with, bool all_leads_lags = true) const;
+    /// Return new expression constructed by simultaneous substitution
+    /// for all keys of the map.
+    ex subst(const map_ex_ex &m, bool all_leads_lags = true) const;
     /// Return new expression constructed by substitution.
     ex substidx(const std::string &what, const std::string &with, bool fix = true) const;
     /// Does expression contain a constant, a variable or and expected value?
     bool has(const ex &what, internal::search_flag f = internal::EXACT_T, bool exact_idx = true) const;
     /// Does expression contain conditional expectations?
     bool has_Es() const;
+    /// Does expression contain products over indices?
+    bool has_prods() const;
 
     /// String representation
     std::string str(int pflag = internal::DEFAULT) const;
@@ -101,6 +114,8 @@ class ex {
     bool operator==(const ex&);
     /// Comparison
     bool operator!=(const ex&);
+    /// Hash value (equal expressions have equal hash values)
+    unsigned hash() const { return m_ptr->hash(); }
 
     /// Is not 0?
     operator bool() const { return !m_ptr->is0(); }
@@ -146,17 +161,29 @@ class ex {
     friend ex ss(const ex &e);
     friend ex E(const ex &e, int l);
     friend ex diff(const ex &expression, const ex &variable);
+    friend vec_ex diff_each(const ex &expression, const vec_ex &variables);
+    friend map_int_ex diff_each(const ex &expression, const vec_ex &variables,
+                               const map_ex_int &positions);
+    friend map_ex_int diff_pos(const vec_ex &variables);
+    friend map_int_ex diff_each(const ex &expression, const ex &tpl,
+                               const internal::idx_ren &iv, const vec_ex &variables,
+                               const map_ex_int &positions, map_ex_ex &tdiffs);
     friend vec_ex expand(const ex &e);
     friend vec_ex expand(const vec_ex &ve);
+    friend ex expand_idx(const ex &e, std::vector<internal::idx_ren> &values);
     friend struct less_ex;
     friend triplet<bool, ex, ex> find_subst(const ex &expression,
                                             const set_ex&);
     friend triplet<bool, ex, ex> find_par_eq_num(const ex &expression);
     friend void find_Es(const ex&, set_ex&);
     friend ex drop_Es(const ex &e);
+    friend ex canon(const ex &e);
+    friend ex simplify(const ex &e);
     friend void collect(const ex &e, set_ex &vars, set_ex &parms);
     friend void collect_lags(const ex &e, map_ex_int &map);
     friend void internal::collect_lags(const internal::ptr_base &p, map_ex_int &map);
+    friend void collect_occ(const ex &e, map_ex_int &occ);
+    friend unsigned cost(const ex &e);
     friend void collect_idx(const ex &e, std::set<unsigned> &iset);
     friend void collect_fidx(const ex &e, std::map<unsigned, unsigned> &iset);
 
@@ -286,6 +313,24 @@ ex prod(const ex &e);
 
 /// Differentiate
 ex diff(const ex &expression, const ex &variable);
+/// Derivatives w.r.t. each variable (zero ex for variables that do not
+/// occur in expression). Each variable that occurs is differentiated
+/// separately, this is not a reverse-mode sweep.
+vec_ex diff_each(const ex &expression, const vec_ex &variables);
+/// Positions of variables / parameters (keyed by variable in lag 0)
+/// for sparse derivatives. Variables cannot have free indices.
+map_ex_int diff_pos(const vec_ex &variables);
+/// Nonzero derivatives w.r.t. variables / parameters keyed by their
+/// positions (see diff_pos).
+map_int_ex diff_each(const ex &expression, const vec_ex &variables,
+                    const map_ex_int &positions);
+/// Nonzero derivatives of an element of expansion of indexed expression.
+/// Derivatives are taken on the template (see expand_idx) w.r.t. variables /
+/// parameters with free indices, once for all elements (they are stored
+/// in tdiffs), and instantiated with values of template indices (iv).
+map_int_ex diff_each(const ex &expression, const ex &tpl,
+                    const internal::idx_ren &iv, const vec_ex &variables,
+                    const map_ex_int &positions, map_ex_ex &tdiffs);
 
 /// Given variable or parameter create new one by appending string to its name
 ex append_name(const ex &e, const std::string &s);
@@ -308,9 +353,22 @@ ex E(const ex &e, int l = 0);
 vec_ex expand(const ex &e);
 /// Expand indexed expressions.
 vec_ex expand(const vec_ex &ve);
+/// Template of indexed expression (indexing dropped); values of its
+/// indices for each element of expansion (in order) are stored in values.
+ex expand_idx(const ex &e, std::vector<internal::idx_ren> &values);
 
 /// Drop expectations
 ex drop_Es(const ex &e);
+/// Canonical form of expression built with deferred canonicalization
+ex canon(const ex &e);
+/// While an object of this class exists, transformations (lag, ss, drop_Es,
+/// subst, substidx) build raw expressions, which may only be passed to
+/// further transformations until canon() is applied.
+using internal::deferred_canon;
+/// Deferred canonicalization in transformation phases (see internal::deferred_phases).
+using internal::deferred_phases;
+/// Algebraic simplification (see internal::simplify).
+ex simplify(const ex &e);
 /// Find expressions under expected value
 void find_Es(const ex &e, set_ex&);
 /// Collect variables and parameters.
@@ -319,6 +377,12 @@ void collect(const ex &e, set_ex &vars, set_ex &parms);
 void collect(const vec_ex &ve, set_ex &vars, set_ex &parms);
 /// Collect variables in lag > 1
 void collect_lags(const ex &e, map_ex_int &map);
+/// Collect occurrences of variables (as lag 0 copies) and parameters;
+/// for each the occ_flag's of lags with which it appears are or'ed.
+void collect_occ(const ex &e, map_ex_int &occ);
+/// Cost of evaluating expression (number of leaves and operations, common
+/// subexpressions counted at each occurrence).
+unsigned cost(const ex &e);
 /// Collect stray indices.
 void collect_idx(const ex &e, std::set<unsigned> &iset);
 /// Collect free indices.
@@ -13,7 +13,9 @@
  */
 
 #include <ops.h>
+#include <diff_cache.h>
 #include <ex_add.h>
+#include <unique_table.h>
 #include <ex_num.h>
 #include <utils.h>
 #include <error.h>
@@ -41,28 +43,24 @@ ex_add::ex_add(const Number &s, const ptr_base &p)
         if (p->flag() & HASIDX) m_type |= HASIDX;
         if (s == 1.) m_type |= SCAL1;
     }
+    update_hash();
 }
 
 
 ex_add::ex_add(const ptr_base &a, const ptr_base &b)
        : ex_base(ADD)
 {
+    // Operands of the same type are merged in place, not copied
     num_ex_pair_vec aa, bb;
-    if (a->type() == ADD) {
-        const ex_add *p = a.get<ex_add>();
-        aa = p->m_ops;
-    } else {
-        aa = num_ex_pair_vec(a);
-    }
-    if (b->type() == ADD) {
-        const ex_add *p = b.get<ex_add>();
-        bb = p->m_ops;
-    } else {
-        bb = num_ex_pair_vec(b);
-    }
+    const num_ex_pair_vec *pa = &aa, *pb = &bb;
+    if (a->type() == ADD) pa = &a.get<ex_add>()->m_ops;
+    else aa = num_ex_pair_vec(a);
+    if (b->type() == ADD) pb = &b.get<ex_add>()->m_ops;
+    else bb = num_ex_pair_vec(b);
 
-    m_ops = num_ex_pair_vec(aa, bb, ADD);
+    m_ops = num_ex_pair_vec(*pa, *pb, ADD);
     update_flags();
+    update_hash();
 }
 
 
@@ -72,6 +70,17 @@ ex_add::ex_add(const num_ex_pair_vec &ops, bool try_reduce)
 {
     if (try_reduce) m_ops.reduce(ADD);
     update_flags();
+    update_hash();
+}
+
+
+
+ex_add::ex_add(num_ex_pair_vec &&ops, bool try_reduce)
+    : ex_base(ADD), m_ops(std::move(ops))
+{
+    if (try_reduce) m_ops.reduce(ADD);
+    update_flags();
+    update_hash();
 }
 
 
@@ -97,21 +106,38 @@ ex_add::update_flags()
 ptr_base
 ex_add::create(const Number &s, const ptr_base &p)
 {
-    return ptr_base(new ex_add(s, p));
+    return unique_table::get_instance().intern(new ex_add(s, p));
 }
 
 
 ptr_base
 ex_add::create(const ptr_base &a, const ptr_base &b)
 {
-    return ptr_base(new ex_add(a, b));
+    return unique_table::get_instance().intern(new ex_add(a, b));
 }
 
 
 ptr_base
 ex_add::create(const num_ex_pair_vec &ops, bool try_reduce)
 {
-    return ptr_base(new ex_add(ops, try_reduce));
+    return unique_table::get_instance().intern(new ex_add(ops, try_reduce));
+}
+
+
+
+ptr_base
+ex_add::create(num_ex_pair_vec &&ops, bool try_reduce)
+{
+    return unique_table::get_instance().intern(new ex_add(std::move(ops), try_reduce));
+}
+
+
+ptr_base
+ex_add::create_raw(num_ex_pair_vec &&ops)
+{
+    ex_add *p = new ex_add(std::move(ops));
+    p->m_type |= RAW;
+    return ptr_base(p);
 }
 
 
@@ -130,6 +156,23 @@ ex_add::compare(const ex_add &b) const
 }
 
 
+bool
+ex_add::identical(const ex_add &b) const
+{
+    return m_ops.identical(b.m_ops);
+}
+
+
+void
+ex_add::update_hash()
+{
+    m_hash = hash_mix(ADD, m_ops.hash());
+    m_sig = m_ops.sig();
+    set_lags();
+    for (unsigned i = 0, n = m_ops.size(); i < n; ++i) add_lags(*m_ops[i].second);
+}
+
+
 
 std::string
 ex_add::str(int pflag) const
@@ -256,14 +299,14 @@ ex_add::tex(int pflag) const
 
 
 int
-ex_add::get_lag_max(bool stop_on_E) const
+ex_add::lag_max(bool stop_on_E) const
 {
     return m_ops.get_lag_max(stop_on_E);
 }
 
 
 int
-ex_add::get_lag_min(bool stop_on_E) const
+ex_add::lag_min(bool stop_on_E) const
 {
     return m_ops.get_lag_min(stop_on_E);
 }
@@ -280,7 +323,7 @@ ex_add::diff(const ptr_base &p) const
     ders.reserve(n);
 
     for (i = 0; i < n; ++i) {
-        ders.push_back(num_ex_pair(m_ops[i].first, m_ops[i].second->diff(p)));
+        ders.push_back(num_ex_pair(m_ops[i].first, cached_diff(m_ops[i].second, p)));
     }
 
     return mk_add(ders);
@@ -290,6 +333,7 @@ ex_add::diff(const ptr_base &p) const
 bool
 ex_add::has(const ptr_base &what, search_flag f, bool exact_idx) const
 {
+    if (!may_have(*what, f)) return false;
     return m_ops.has(what, f, exact_idx);
 }
 
@@ -38,11 +38,15 @@ class ex_add : public ex_base {
     ex_add(const ptr_base &a, const ptr_base &b);
     /// Constructor from num_ex_pair_vec
     explicit ex_add(const num_ex_pair_vec &ops, bool try_reduce = false);
+    /// Constructor from temporary num_ex_pair_vec (buffer is reused)
+    explicit ex_add(num_ex_pair_vec &&ops, bool try_reduce = false);
     /// Destructor
     virtual ~ex_add() { ; }
 
     /// Comparison
     int compare(const ex_add&) const;
+    /// Is node identical to another one (subexpressions compared by address)?
+    bool identical(const ex_add&) const;
 
     /// Constructor from an expression.
     static ptr_base create(const ptr_base &p);
@@ -52,6 +56,10 @@ class ex_add : public ex_base {
     static ptr_base create(const ptr_base &a, const ptr_base &b);
     /// Constructor from num_ex_pair_vec.
     static ptr_base create(const num_ex_pair_vec &ops, bool try_reduce = false);
+    /// Constructor from temporary num_ex_pair_vec.
+    static ptr_base create(num_ex_pair_vec &&ops, bool try_reduce = false);
+    /// Raw node from operands (neither reduced nor hash-consed, see canon())
+    static ptr_base create_raw(num_ex_pair_vec &&ops);
 
     /// Free memory (assumes that ptr is acutally pointer to ex_add)
     static void destroy(ex_base *ptr);
@@ -63,9 +71,9 @@ class ex_add : public ex_base {
     /// LaTeX string representation
     virtual std::string tex(int pflag) const;
     /// Max lag in expression
-    virtual int get_lag_max(bool stop_on_E = false) const;
+    virtual int lag_max(bool stop_on_E) const;
     /// Min lag in expression
-    virtual int get_lag_min(bool stop_on_E = false) const;
+    virtual int lag_min(bool stop_on_E) const;
 
     /// Derivative wrt a variable
     virtual ptr_base diff(const ptr_base&) const;
@@ -87,6 +95,8 @@ class ex_add : public ex_base {
     num_ex_pair_vec m_ops;
 
     void update_flags();
+    // Compute hash value, signature and lags
+    void update_hash();
 
 }; /* class ex_add */
 
@@ -17,9 +17,11 @@
 #define SYMBOLIC_EX_BASE_H
 
 #include <string>
+#include <climits>
 #include <stringhash.h>
 #include <decl.h>
 #include <number.h>
+#include <pool.h>
 
 
 namespace symbolic {
@@ -32,10 +34,17 @@ class ex_base {
 
   public:
     /// Constructor
-    explicit ex_base(unsigned type) : m_type(type) { ; }
+    explicit ex_base(unsigned type) : m_type(type), m_sig(0), m_rc(0) { ; }
     /// Destructor
     virtual ~ex_base() { ; }
 
+    /// Nodes are allocated from size-class pools.
+    static void* operator new(std::size_t sz)
+        { return node_pools::get_instance().alloc(sz); }
+    /// Nodes are returned to size-class pools.
+    static void operator delete(void *p, std::size_t sz)
+        { node_pools::get_instance().free(p, sz); }
+
     /// String representation.
     virtual std::string str(int pflag = DEFAULT) const = 0;
     /// String representation using string 2 string map (name substitution).
@@ -43,10 +52,18 @@ class ex_base {
     /// LaTeX string representation.
     virtual std::string tex(int pflag = DEFAULT) const = 0;
 
-    /// Max lag in expression.
-    virtual int get_lag_max(bool stop_on_E = false) const = 0;
-    /// Min lag in expression.
-    virtual int get_lag_min(bool stop_on_E = false) const = 0;
+    /// Max lag in expression (cached on construction).
+    int get_lag_max(bool stop_on_E = false) const
+    {
+        signed char l = m_lags[stop_on_E ? 2 : 0];
+        return (l == lag_ovf) ? lag_max(stop_on_E) : unpack_lag(l);
+    }
+    /// Min lag in expression (cached on construction).
+    int get_lag_min(bool stop_on_E = false) const
+    {
+        signed char l = m_lags[stop_on_E ? 3 : 1];
+        return (l == lag_ovf) ? lag_min(stop_on_E) : unpack_lag(l);
+    }
 
     /// Derivative w.r.t. a variable.
     virtual ptr_base diff(const ptr_base&) const = 0;
@@ -69,8 +86,17 @@ class ex_base {
     unsigned type() const { return (m_type & 0xffffff00); }
     /// Flag
     unsigned flag() const { return (m_type & 0xff); }
-    /// Hash value
+    /// Structural hash value (equal expressions have equal hash values)
     unsigned hash() const { return m_hash; }
+    /// Signature: bits of all symbol names and variable lags in expression
+    unsigned long long sig() const { return m_sig; }
+    /// Can expression have a given subexpression? If false, has() is false.
+    bool may_have(const ex_base &what, search_flag f) const
+    {
+        // Matches with other lags are searched for unless f is EXACT_T
+        unsigned long long s = (f == EXACT_T) ? what.m_sig : (what.m_sig & sig_names);
+        return !(s & ~m_sig);
+    }
 #ifdef DEBUG_SYMBOLIC
     /// Information for debugging
     void info() const;
@@ -78,11 +104,90 @@ class ex_base {
 
   protected:
     /// No default constructor
-    ex_base() { ; }
+    ex_base() : m_sig(0), m_rc(0) { ; }
     /// Type & flags
     unsigned m_type;
-    /// Hash value
+    /// Structural hash value, computed on construction
     unsigned m_hash;
+    /// Signature, computed on construction
+    unsigned long long m_sig;
+    /// Lag extrema (max, min, max and min stopping on E[]) packed with
+    /// pack_lag, set by update_hash() of derived classes. They are stored
+    /// in what would otherwise be padding.
+    signed char m_lags[4];
+
+    /// Max lag in expression (only used for lags that do not fit in m_lags).
+    virtual int lag_max(bool stop_on_E) const = 0;
+    /// Min lag in expression (only used for lags that do not fit in m_lags).
+    virtual int lag_min(bool stop_on_E) const = 0;
+
+    /// Set lags of expression with variable in lag l (INT_MIN for none
+    /// or steady state)
+    void set_lags(int l = INT_MIN)
+    {
+        m_lags[0] = m_lags[2] = pack_lag(l);
+        m_lags[1] = m_lags[3] = pack_lag((l == INT_MIN) ? INT_MAX : l);
+    }
+    /// Set lags to those of a subexpression
+    void set_lags(const ex_base &e)
+    {
+        for (unsigned i = 0; i < 4; ++i) m_lags[i] = e.m_lags[i];
+    }
+    /// Merge lags of a subexpression into lags of expression
+    void add_lags(const ex_base &e)
+    {
+        m_lags[0] = max_lag(m_lags[0], e.m_lags[0]);
+        m_lags[1] = min_lag(m_lags[1], e.m_lags[1]);
+        m_lags[2] = max_lag(m_lags[2], e.m_lags[2]);
+        m_lags[3] = min_lag(m_lags[3], e.m_lags[3]);
+    }
+
+    /// Signature bits used by names
+    static const unsigned long long sig_names = (1ull << 56) - 1;
+    /// Signature bit of a name
+    static unsigned long long sig_name(unsigned name) { return 1ull << (name % 56); }
+    /// Signature bit of a lag (-1, 0, 1 or other)
+    static unsigned long long sig_lag(int lag)
+    {
+        return 1ull << (((lag >= -1) && (lag <= 1)) ? 57 + lag : 59);
+    }
+
+    /// Packed lag: INT_MIN (no lags, max), INT_MAX (no lags, min), lag
+    /// small in absolute value or marker of lag that has to be recomputed.
+    /// Apart from the marker, packing preserves order.
+    static const signed char lag_none_max = -128, lag_none_min = 127, lag_ovf = -127;
+    /// Pack lag
+    static signed char pack_lag(int l)
+    {
+        if (l == INT_MIN) return lag_none_max;
+        if (l == INT_MAX) return lag_none_min;
+        return ((l >= -126) && (l <= 126)) ? (signed char) l : lag_ovf;
+    }
+    /// Unpack lag (other than lag_ovf)
+    static int unpack_lag(signed char l)
+    {
+        if (l == lag_none_max) return INT_MIN;
+        if (l == lag_none_min) return INT_MAX;
+        return l;
+    }
+    /// Max of packed lags
+    static signed char max_lag(signed char a, signed char b)
+    {
+        if ((a == lag_ovf) || (b == lag_ovf)) return lag_ovf;
+        return (a > b) ? a : b;
+    }
+    /// Min of packed lags
+    static signed char min_lag(signed char a, signed char b)
+    {
+        if ((a == lag_ovf) || (b == lag_ovf)) return lag_ovf;
+        return (a < b) ? a : b;
+    }
+
+  private:
+    // Reference counter (managed by ptr_base)
+    int m_rc;
+
+    friend class ptr_base;
 
 }; /* class ex_base */
 
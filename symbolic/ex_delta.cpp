@@ -17,6 +17,7 @@
 #include <stringhash.h>
 #include <utils.h>
 #include <cmp.h>
+#include <unique_table.h>
 #include <climits>
 
 
@@ -48,6 +49,7 @@ ex_delta::ex_delta(int i1, int i2) : ex_base(DELTA | SINGLE | HASIDX)
         m_idx1 = i2;
         m_idx2 = i1;
     }
+    update_hash();
 }
 
 
@@ -56,7 +58,7 @@ ex_delta::create(int i1, int i2)
 {
     if (i1 == i2) return ex_num::one();
     if ((i1 < 0) && (i2 < 0) && (i1 != i2)) return ex_num::zero();
-    return ptr_base(new ex_delta(i1, i2));
+    return unique_table::get_instance().intern(new ex_delta(i1, i2));
 }
 
 
@@ -77,6 +79,21 @@ ex_delta::compare(const ex_delta &b) const
 }
 
 
+bool
+ex_delta::identical(const ex_delta &b) const
+{
+    return (m_idx1 == b.m_idx1) && (m_idx2 == b.m_idx2);
+}
+
+
+void
+ex_delta::update_hash()
+{
+    m_hash = hash_mix(hash_mix(DELTA, (unsigned) m_idx1), (unsigned) m_idx2);
+    set_lags();
+}
+
+
 
 std::string
 ex_delta::str(int pflag) const
@@ -156,14 +173,14 @@ if (id < 0) { \
 
 
 int
-ex_delta::get_lag_max(bool) const
+ex_delta::lag_max(bool) const
 {
     return INT_MIN;
 }
 
 
 int
-ex_delta::get_lag_min(bool) const
+ex_delta::lag_min(bool) const
 {
     return INT_MAX;
 }
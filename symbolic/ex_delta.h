@@ -37,6 +37,8 @@ class ex_delta : public ex_base {
 
     /// Comparison
     int compare(const ex_delta&) const;
+    /// Is node identical to another one (subexpressions compared by address)?
+    bool identical(const ex_delta&) const;
 
     /// String representation
     virtual std::string str(int pflag) const;
@@ -45,9 +47,9 @@ class ex_delta : public ex_base {
     /// LaTeX string representation
     virtual std::string tex(int pflag) const;
     /// Max lag in expression
-    virtual int get_lag_max(bool stop_on_E = false) const;
+    virtual int lag_max(bool stop_on_E) const;
     /// Min lag in expression
-    virtual int get_lag_min(bool stop_on_E = false) const;
+    virtual int lag_min(bool stop_on_E) const;
 
     /// Derivative wrt a variable
     virtual ptr_base diff(const ptr_base&) const;
@@ -57,6 +59,11 @@ class ex_delta : public ex_base {
     /// Does expression have a given index?
     virtual bool hasidx(int idx) const;
 
+    /// Get first index
+    int get_idx1() const { return m_idx1; }
+    /// Get second index
+    int get_idx2() const { return m_idx2; }
+
   private:
     // No default constructor
     ex_delta();
@@ -68,8 +75,12 @@ class ex_delta : public ex_base {
     ptr_base substidx(unsigned what, int with) const;
     // Indices
     int m_idx1, m_idx2;
+    // Compute hash value, signature and lags
+    void update_hash();
 
     friend ptr_base substidx(const ptr_base &e, unsigned what, int with);
+    friend ptr_base substidx(const ptr_base &e, const idx_ren &iv);
+    friend unsigned hash_idx(const ptr_base &p, const idx_ren &ren);
     friend void collect_idx(const ptr_base &p, std::set<unsigned> &iset);
     friend class ex_symbidx;
     friend class ex_vartidx;
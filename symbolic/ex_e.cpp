@@ -16,6 +16,8 @@
 #include <error.h>
 #include <ex_e.h>
 #include <cmp.h>
+#include <diff_cache.h>
+#include <unique_table.h>
 #include <ops.h>
 #include <utils.h>
 #include <climits>
@@ -27,12 +29,13 @@ using namespace symbolic::internal;
 ex_e::ex_e(const ptr_base &e, int l)
     : ex_base(EX | HAST | (e->flag() & HASIDX)), m_arg(e), m_lag(l)
 {
+    update_hash();
 }
 
 ptr_base
 ex_e::create(const ptr_base &e, int l)
 {
-    return ptr_base(new ex_e(e, l));
+    return unique_table::get_instance().intern(new ex_e(e, l));
 }
 
 
@@ -52,6 +55,25 @@ ex_e::compare(const ex_e &b) const
 }
 
 
+bool
+ex_e::identical(const ex_e &b) const
+{
+    return (m_lag == b.m_lag) && (m_arg.get() == b.m_arg.get());
+}
+
+
+void
+ex_e::update_hash()
+{
+    m_hash = hash_mix(hash_mix(EX, (unsigned) m_lag), m_arg->hash());
+    m_sig = m_arg->sig();
+    set_lags(*m_arg);
+    m_lags[0] = max_lag(m_lags[0], pack_lag(m_lag));
+    m_lags[1] = min_lag(m_lags[1], pack_lag(m_lag));
+    m_lags[2] = m_lags[3] = pack_lag(m_lag);
+}
+
+
 std::string
 ex_e::str(int pflag) const
 {
@@ -95,7 +117,7 @@ ex_e::tex(int pflag) const
 
 
 int
-ex_e::get_lag_max(bool stop_on_E) const
+ex_e::lag_max(bool stop_on_E) const
 {
     if (stop_on_E) return m_lag;
     return std::max(m_lag, m_arg->get_lag_max());
@@ -103,7 +125,7 @@ ex_e::get_lag_max(bool stop_on_E) const
 
 
 int
-ex_e::get_lag_min(bool stop_on_E) const
+ex_e::lag_min(bool stop_on_E) const
 {
     if (stop_on_E) return m_lag;
     return std::min(m_lag, m_arg->get_lag_min());
@@ -114,17 +136,19 @@ ex_e::get_lag_min(bool stop_on_E) const
 ptr_base
 ex_e::diff(const ptr_base &p) const
 {
-    return mk_E(m_arg->diff(p), m_lag);
+    return mk_E(cached_diff(m_arg, p), m_lag);
 }
 
 
 bool
 ex_e::has(const ptr_base &what, search_flag f, bool exact_idx) const
 {
+    if (!may_have(*what, f)) return false;
     if (what->type() == EX) {
         const ex_e *w = what.get<ex_e>();
         int ld = m_lag - w->m_lag;
-        bool ok = !symbolic::internal::compare(symbolic::internal::lag(m_arg, ld), w->m_arg);
+        deferred_canon eager(false);
+        bool ok = symbolic::internal::equal(symbolic::internal::lag(m_arg, ld), w->m_arg);
         if (!ok) return false;
         switch (f) {
             case EXACT_T:
@@ -156,14 +180,7 @@ ex_e::hasidx(int idx) const
 ptr_base
 ex_e::lag(int l) const
 {
+    deferred_canon eager(false);
     if (l == INT_MIN) return symbolic::internal::lag(m_arg, l);
     return create(symbolic::internal::lag(m_arg, l), m_lag + l);
 }
-
-
-
-
-
-
-
-
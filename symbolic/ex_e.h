@@ -39,6 +39,8 @@ class ex_e : public ex_base {
 
     /// Comparison
     int compare(const ex_e&) const;
+    /// Is node identical to another one (subexpressions compared by address)?
+    bool identical(const ex_e&) const;
 
     /// String representation
     virtual std::string str(int pflag) const;
@@ -48,9 +50,9 @@ class ex_e : public ex_base {
     /// LaTeX string representation
     virtual std::string tex(int pflag) const;
     /// Max lag in expression
-    virtual int get_lag_max(bool stop_on_E = false) const;
+    virtual int lag_max(bool stop_on_E) const;
     /// Min lag in expression
-    virtual int get_lag_min(bool stop_on_E = false) const;
+    virtual int lag_min(bool stop_on_E) const;
 
     /// Derivative wrt a variable
     virtual ptr_base diff(const ptr_base&) const;
@@ -74,6 +76,8 @@ class ex_e : public ex_base {
     ptr_base m_arg;
     // Lag
     int m_lag;
+    // Compute hash value, signature and lags
+    void update_hash();
 
 }; /* class ex_e */
 
@@ -16,7 +16,9 @@
 #include <ex_func.h>
 #include <ex_num.h>
 #include <ops.h>
+#include <diff_cache.h>
 #include <cmp.h>
+#include <unique_table.h>
 #include <error.h>
 #include <cmath>
 #include <utils.h>
@@ -69,6 +71,7 @@ ex_func::ex_func(func_code c, const ptr_base &arg)
     : ex_base(FUN | (arg->flag() & HAST) | (arg->flag() & HASIDX) | SINGLE),
       m_code(c), m_arg(arg)
 {
+    update_hash();
 }
 
 
@@ -76,7 +79,16 @@ ex_func::ex_func(func_code c, const ptr_base &arg)
 ptr_base
 ex_func::create(func_code c, const ptr_base &arg)
 {
-    return ptr_base(new ex_func(c, arg));
+    return unique_table::get_instance().intern(new ex_func(c, arg));
+}
+
+
+ptr_base
+ex_func::create_raw(func_code c, const ptr_base &arg)
+{
+    ex_func *p = new ex_func(c, arg);
+    p->m_type |= RAW;
+    return ptr_base(p);
 }
 
 
@@ -97,6 +109,22 @@ ex_func::compare(const ex_func &b) const
 }
 
 
+bool
+ex_func::identical(const ex_func &b) const
+{
+    return (m_code == b.m_code) && (m_arg.get() == b.m_arg.get());
+}
+
+
+void
+ex_func::update_hash()
+{
+    m_hash = hash_mix(hash_mix(FUN, (unsigned) m_code), m_arg->hash());
+    m_sig = m_arg->sig();
+    set_lags(*m_arg);
+}
+
+
 std::string
 ex_func::str(int pflag) const
 {
@@ -133,14 +161,14 @@ ex_func::eval(func_code c, const symbolic::Number &x)
 
 
 int
-ex_func::get_lag_max(bool stop_on_E) const
+ex_func::lag_max(bool stop_on_E) const
 {
     return m_arg->get_lag_max(stop_on_E);
 }
 
 
 int
-ex_func::get_lag_min(bool stop_on_E) const
+ex_func::lag_min(bool stop_on_E) const
 {
     return m_arg->get_lag_min(stop_on_E);
 }
@@ -154,7 +182,7 @@ ex_func::get_lag_min(bool stop_on_E) const
 ptr_base
 ex_func::diff(const ptr_base &p) const
 {
-    ptr_base d = m_arg->diff(p);
+    ptr_base d = cached_diff(m_arg, p);
     if (d->is0()) return d;
 
     ptr_base x = m_arg;
@@ -197,6 +225,7 @@ ex_func::diff(const ptr_base &p) const
 bool
 ex_func::has(const ptr_base &what, search_flag f, bool exact_idx) const
 {
+    if (!may_have(*what, f)) return false;
     return m_arg->has(what, f, exact_idx);
 }
 
@@ -35,11 +35,15 @@ class ex_func : public ex_base {
 
     /// Constructor from two arguments.
     static ptr_base create(func_code c, const ptr_base &arg);
+    /// Raw node (not hash-consed, see canon())
+    static ptr_base create_raw(func_code c, const ptr_base &arg);
     /// Free memory (assumes that ptr is actually pointer to ex_func)
     static void destroy(ex_base *ptr);
 
     /// Comparison
     int compare(const ex_func&) const;
+    /// Is node identical to another one (subexpressions compared by address)?
+    bool identical(const ex_func&) const;
 
     /// String representation
     virtual std::string str(int pflag) const;
@@ -48,9 +52,9 @@ class ex_func : public ex_base {
     /// LaTeX string representation
     virtual std::string tex(int pflag) const;
     /// Max lag in expression
-    virtual int get_lag_max(bool stop_on_E = false) const;
+    virtual int lag_max(bool stop_on_E) const;
     /// Min lag in expression
-    virtual int get_lag_min(bool stop_on_E = false) const;
+    virtual int lag_min(bool stop_on_E) const;
 
     /// Derivative wrt a variable
     virtual ptr_base diff(const ptr_base&) const;
@@ -75,6 +79,8 @@ class ex_func : public ex_base {
     func_code m_code;
     // Pointer to an argument
     ptr_base m_arg;
+    // Compute hash value, signature and lags
+    void update_hash();
 
 }; /* class ex_func */
 
@@ -15,7 +15,9 @@
 
 #include <ex_idx.h>
 #include <ops.h>
+#include <diff_cache.h>
 #include <cmp.h>
+#include <unique_table.h>
 #include <error.h>
 #include <cmath>
 #include <utils.h>
@@ -35,7 +37,21 @@ ex_idx::create(const idx_ex &ie, const ptr_base &e)
     if (e->type() == IDX) {
         if (e.get<ex_idx>()->has_ie(ie)) return e;
     }
-    return ptr_base(new ex_idx(ie, e));
+    return unique_table::get_instance().intern(new ex_idx(ie, e));
+}
+
+
+ptr_base
+ex_idx::create_raw(const idx_ex &ie, const ptr_base &e)
+{
+    if (!ie) return e;
+    if (!e->hasidx(ie.m_id)) return e;
+    if (e->type() == IDX) {
+        if (e.get<ex_idx>()->has_ie(ie)) return e;
+    }
+    ex_idx *p = new ex_idx(ie, e);
+    p->m_type |= RAW;
+    return ptr_base(p);
 }
 
 void
@@ -50,10 +66,30 @@ ex_idx::compare(const ex_idx &b) const
 {
     int c = m_ie.compare(b.m_ie, false);
     if (c) return c;
+    deferred_canon eager(false);
     return symbolic::internal::compare(m_e, substidx(b.m_e, b.m_ie.get_id(), m_ie.get_id()));
 }
 
 
+bool
+ex_idx::identical(const ex_idx &b) const
+{
+    return m_ie.identical(b.m_ie) && (m_e.get() == b.m_e.get());
+}
+
+
+// Comparison of indexed expressions is up to renaming of the index
+// so the expression is hashed with the index renamed to a placeholder.
+void
+ex_idx::update_hash()
+{
+    idx_ren ren(1, std::pair<unsigned, int>(m_ie.get_id(), INT_MIN + 1));
+    m_hash = hash_mix(hash_mix(IDX, m_ie.hash(false)), hash_idx(m_e, ren));
+    m_sig = m_e->sig();
+    set_lags(*m_e);
+}
+
+
 std::string
 ex_idx::str(int pflag) const
 {
@@ -97,14 +133,14 @@ ex_idx::tex(int pflag) const
 
 
 int
-ex_idx::get_lag_max(bool stop_on_E) const
+ex_idx::lag_max(bool stop_on_E) const
 {
     return m_e->get_lag_max(stop_on_E);
 }
 
 
 int
-ex_idx::get_lag_min(bool stop_on_E) const
+ex_idx::lag_min(bool stop_on_E) const
 {
     return m_e->get_lag_min(stop_on_E);
 }
@@ -114,13 +150,14 @@ ex_idx::get_lag_min(bool stop_on_E) const
 ptr_base
 ex_idx::diff(const ptr_base &p) const
 {
-    return create(m_ie, m_e->diff(p));
+    return create(m_ie, cached_diff(m_e, p));
 }
 
 
 bool
 ex_idx::has(const ptr_base &what, search_flag f, bool exact_idx) const
 {
+    if (!may_have(*what, f)) return false;
     return m_e->has(what, f, exact_idx);
 }
 
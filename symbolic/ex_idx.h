@@ -32,17 +32,21 @@ class ex_idx : public ex_base {
     /// Constructor from indexing expression and expression
     ex_idx(const idx_ex &ie, const ptr_base &e)
         : ex_base(IDX | HASIDX | (e->flag() & HAST) | (e->flag() & SINGLE)), m_ie(ie), m_e(e)
-        { ; }
+        { update_hash(); }
     /// Destructor
     ~ex_idx() { ; }
 
     /// Constructor from from indexing expression and expression
     static ptr_base create(const idx_ex &ie, const ptr_base &e);
+    /// Raw node (not hash-consed, see canon())
+    static ptr_base create_raw(const idx_ex &ie, const ptr_base &e);
     /// Free memory (assumes that ptr is actually pointer to ex_idx)
     static void destroy(ex_base *ptr);
 
     /// Comparison
     int compare(const ex_idx&) const;
+    /// Is node identical to another one (subexpressions compared by address)?
+    bool identical(const ex_idx&) const;
 
     /// String representation
     virtual std::string str(int pflag) const;
@@ -52,9 +56,9 @@ class ex_idx : public ex_base {
     /// LaTeX string representation
     virtual std::string tex(int pflag) const;
     /// Max lag in expression
-    virtual int get_lag_max(bool stop_on_E = false) const;
+    virtual int lag_max(bool stop_on_E) const;
     /// Min lag in expression
-    virtual int get_lag_min(bool stop_on_E = false) const;
+    virtual int lag_min(bool stop_on_E) const;
 
     /// Derivative wrt a variable
     virtual ptr_base diff(const ptr_base&) const;
@@ -81,6 +85,8 @@ class ex_idx : public ex_base {
 
     // Does it have an indexing expression?
     bool has_ie(const idx_ex &ie) const;
+    // Compute hash value, signature and lags
+    void update_hash();
 
     friend ptr_base substidx(const ptr_base &e, unsigned what, int with);
     friend void collect_idx(const ptr_base &p, std::set<unsigned> &iset,
@@ -17,8 +17,10 @@
 #include <ex_pow.h>
 #include <ex_num.h>
 #include <ops.h>
+#include <diff_cache.h>
 #include <utils.h>
 #include <cmp.h>
+#include <unique_table.h>
 
 
 using namespace symbolic::internal;
@@ -35,11 +37,13 @@ ex_mul::ex_mul(const Number &s, const ptr_base &p)
         if (s == 1.) m_type |= SCAL1;
         if (p->flag() & HAST) m_type |= HAST;
         if (p->flag() & HASIDX) m_type |= HASIDX;
+        update_hash();
         return;
     }
 
     m_ops = num_ex_pair_vec(s, p.get<ex_mul>()->m_ops, MUL);
     update_flags();
+    update_hash();
 }
 
 
@@ -47,23 +51,18 @@ ex_mul::ex_mul(const Number &s, const ptr_base &p)
 ex_mul::ex_mul(const ptr_base &a, const ptr_base &b)
        : ex_base(MUL)
 {
+    // Operands of the same type are merged in place, not copied
     num_ex_pair_vec aa, bb;
-    if (a->type() == MUL) {
-        const ex_mul *p = a.get<ex_mul>();
-        aa = p->m_ops;
-    } else {
-        aa = num_ex_pair_vec(a);
-    }
-    if (b->type() == MUL) {
-        const ex_mul *p = b.get<ex_mul>();
-        bb = p->m_ops;
-    } else {
-        bb = num_ex_pair_vec(b);
-    }
+    const num_ex_pair_vec *pa = &aa, *pb = &bb;
+    if (a->type() == MUL) pa = &a.get<ex_mul>()->m_ops;
+    else aa = num_ex_pair_vec(a);
+    if (b->type() == MUL) pb = &b.get<ex_mul>()->m_ops;
+    else bb = num_ex_pair_vec(b);
 
-    m_ops = num_ex_pair_vec(aa, bb, MUL);
+    m_ops = num_ex_pair_vec(*pa, *pb, MUL);
 
     update_flags();
+    update_hash();
 }
 
 
@@ -72,6 +71,17 @@ ex_mul::ex_mul(const num_ex_pair_vec &ops, bool try_reduce) : ex_base(MUL), m_op
 {
     if (try_reduce) m_ops.reduce(MUL);
     update_flags();
+    update_hash();
+}
+
+
+
+ex_mul::ex_mul(num_ex_pair_vec &&ops, bool try_reduce)
+    : ex_base(MUL), m_ops(std::move(ops))
+{
+    if (try_reduce) m_ops.reduce(MUL);
+    update_flags();
+    update_hash();
 }
 
 
@@ -99,7 +109,7 @@ ex_mul::update_flags()
 ptr_base
 ex_mul::create(const Number &s, const ptr_base &p)
 {
-    return ptr_base(new ex_mul(s, p));
+    return unique_table::get_instance().intern(new ex_mul(s, p));
 }
 
 
@@ -107,7 +117,7 @@ ex_mul::create(const Number &s, const ptr_base &p)
 ptr_base
 ex_mul::create(const ptr_base &a, const ptr_base &b)
 {
-    return ptr_base(new ex_mul(a, b));
+    return unique_table::get_instance().intern(new ex_mul(a, b));
 }
 
 
@@ -115,7 +125,24 @@ ex_mul::create(const ptr_base &a, const ptr_base &b)
 ptr_base
 ex_mul::create(const num_ex_pair_vec &ops, bool try_reduce)
 {
-    return ptr_base(new ex_mul(ops, try_reduce));
+    return unique_table::get_instance().intern(new ex_mul(ops, try_reduce));
+}
+
+
+
+ptr_base
+ex_mul::create(num_ex_pair_vec &&ops, bool try_reduce)
+{
+    return unique_table::get_instance().intern(new ex_mul(std::move(ops), try_reduce));
+}
+
+
+ptr_base
+ex_mul::create_raw(num_ex_pair_vec &&ops)
+{
+    ex_mul *p = new ex_mul(std::move(ops));
+    p->m_type |= RAW;
+    return ptr_base(p);
 }
 
 
@@ -135,6 +162,23 @@ ex_mul::compare(const ex_mul &b) const
 }
 
 
+bool
+ex_mul::identical(const ex_mul &b) const
+{
+    return m_ops.identical(b.m_ops);
+}
+
+
+void
+ex_mul::update_hash()
+{
+    m_hash = hash_mix(MUL, m_ops.hash());
+    m_sig = m_ops.sig();
+    set_lags();
+    for (unsigned i = 0, n = m_ops.size(); i < n; ++i) add_lags(*m_ops[i].second);
+}
+
+
 
 std::string
 ex_mul::str(int pflag) const
@@ -277,14 +321,14 @@ ex_mul::tex(int pflag) const
 
 
 int
-ex_mul::get_lag_max(bool stop_on_E) const
+ex_mul::lag_max(bool stop_on_E) const
 {
     return m_ops.get_lag_max(stop_on_E);
 }
 
 
 int
-ex_mul::get_lag_min(bool stop_on_E) const
+ex_mul::lag_min(bool stop_on_E) const
 {
     return m_ops.get_lag_min(stop_on_E);
 }
@@ -298,7 +342,7 @@ ex_mul::diff(const ptr_base &p) const
     if (!n) return ex_num::zero();
 
     if (n == 1) {
-        return mk_mul(mk_mul(m_ops[0].second->diff(p), ex_num::create(m_ops[0].first)),
+        return mk_mul(mk_mul(cached_diff(m_ops[0].second, p), ex_num::create(m_ops[0].first)),
                       mk_pow(m_ops[0].second, ex_num::create(m_ops[0].first - 1)));
     }
 
@@ -308,7 +352,7 @@ ex_mul::diff(const ptr_base &p) const
     for (i = 0; i < n; ++i) {
         prods = m_ops;
         prods.erase(prods.begin() + i);
-        ptr_base der = mk_mul(mk_mul(m_ops[i].second->diff(p),
+        ptr_base der = mk_mul(mk_mul(cached_diff(m_ops[i].second, p),
                                         ex_num::create(m_ops[i].first)),
                               mk_mul(mk_pow(m_ops[i].second, ex_num::create(m_ops[i].first - 1)),
                                         mk_mul(prods)));
@@ -322,6 +366,7 @@ ex_mul::diff(const ptr_base &p) const
 bool
 ex_mul::has(const ptr_base &what, search_flag f, bool exact_idx) const
 {
+    if (!may_have(*what, f)) return false;
     return m_ops.has(what, f, exact_idx);
 }
 
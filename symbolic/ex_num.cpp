@@ -16,6 +16,7 @@
 #include <ex_num.h>
 #include <utils.h>
 #include <cmp.h>
+#include <unique_table.h>
 #include <climits>
 
 using namespace symbolic;
@@ -25,7 +26,7 @@ using namespace symbolic::internal;
 ptr_base
 ex_num::create(const Number &n)
 {
-    return ptr_base(new ex_num(n));
+    return unique_table::get_instance().intern(new ex_num(n));
 }
 
 
@@ -43,6 +44,21 @@ ex_num::compare(const ex_num &b) const
 }
 
 
+bool
+ex_num::identical(const ex_num &b) const
+{
+    return identical_num(m_val, b.m_val);
+}
+
+
+void
+ex_num::update_hash()
+{
+    m_hash = hash_mix(NUM, hash_num(m_val));
+    set_lags();
+}
+
+
 std::string
 ex_num::str(int pflag) const
 {
@@ -65,14 +81,14 @@ ex_num::tex(int pflag) const
 
 
 int
-ex_num::get_lag_max(bool) const
+ex_num::lag_max(bool) const
 {
     return INT_MIN;
 }
 
 
 int
-ex_num::get_lag_min(bool) const
+ex_num::lag_min(bool) const
 {
     return INT_MAX;
 }
@@ -28,7 +28,7 @@ namespace internal {
 class ex_num : public ex_base {
   public:
     /// Constructor from Number
-    explicit ex_num(const Number &n) : ex_base(NUM|SINGLE), m_val(n) { ; }
+    explicit ex_num(const Number &n) : ex_base(NUM|SINGLE), m_val(n) { update_hash(); }
     /// Destructor
     ~ex_num() { ; }
 
@@ -37,7 +37,7 @@ class ex_num : public ex_base {
     /// One
     static ptr_base one() { return create(1.); }
     /// Zero
-    static ptr_base zero() { return create(0.); }
+    static ptr_base zero() { return ptr_base::zero(); }
     /// Free memory (assumes that ptr is actually pointer to ex_num)
     static void destroy(ex_base *ptr);
 
@@ -46,6 +46,8 @@ class ex_num : public ex_base {
 
     /// Comparison
     int compare(const ex_num&) const;
+    /// Is node identical to another one (subexpressions compared by address)?
+    bool identical(const ex_num&) const;
 
     /// String representation
     virtual std::string str(int) const;
@@ -55,9 +57,9 @@ class ex_num : public ex_base {
     virtual std::string tex(int) const;
 
     /// Max lag in expression
-    virtual int get_lag_max(bool stop_on_E = false) const;
+    virtual int lag_max(bool stop_on_E) const;
     /// Min lag in expression
-    virtual int get_lag_min(bool stop_on_E = false) const;
+    virtual int lag_min(bool stop_on_E) const;
 
     /// Derivative wrt a variable
     virtual ptr_base diff(const ptr_base&) const;
@@ -72,6 +74,8 @@ class ex_num : public ex_base {
     ex_num();
     // Value
     Number m_val;
+    // Compute hash value, signature and lags
+    void update_hash();
 
 }; /* class ex_num */
 
@@ -15,7 +15,9 @@
 #include <ex_pow.h>
 #include <ex_num.h>
 #include <ops.h>
+#include <diff_cache.h>
 #include <cmp.h>
+#include <unique_table.h>
 #include <cmath>
 #include <climits>
 #include <algorithm>
@@ -29,13 +31,23 @@ ex_pow::ex_pow(const ptr_base &a, const ptr_base &b)
                   | (a->flag() & HASIDX) | (b->flag() & HASIDX) | SINGLE),
       m_base(a), m_exp(b)
 {
+    update_hash();
 }
 
 
 ptr_base
 ex_pow::create(const ptr_base &a, const ptr_base &b)
 {
-    return ptr_base(new ex_pow(a, b));
+    return unique_table::get_instance().intern(new ex_pow(a, b));
+}
+
+
+ptr_base
+ex_pow::create_raw(const ptr_base &a, const ptr_base &b)
+{
+    ex_pow *p = new ex_pow(a, b);
+    p->m_type |= RAW;
+    return ptr_base(p);
 }
 
 void
@@ -54,6 +66,23 @@ ex_pow::compare(const ex_pow &b) const
 }
 
 
+bool
+ex_pow::identical(const ex_pow &b) const
+{
+    return (m_base.get() == b.m_base.get()) && (m_exp.get() == b.m_exp.get());
+}
+
+
+void
+ex_pow::update_hash()
+{
+    m_hash = hash_mix(hash_mix(POW, m_base->hash()), m_exp->hash());
+    m_sig = m_base->sig() | m_exp->sig();
+    set_lags(*m_base);
+    add_lags(*m_exp);
+}
+
+
 std::string
 ex_pow::str(int pflag) const
 {
@@ -132,14 +161,14 @@ ex_pow::tex(int pflag) const
 
 
 int
-ex_pow::get_lag_max(bool stop_on_E) const
+ex_pow::lag_max(bool stop_on_E) const
 {
     return std::max(m_base->get_lag_max(stop_on_E), m_exp->get_lag_max(stop_on_E));
 }
 
 
 int
-ex_pow::get_lag_min(bool stop_on_E) const
+ex_pow::lag_min(bool stop_on_E) const
 {
     return std::min(m_base->get_lag_min(stop_on_E), m_exp->get_lag_min(stop_on_E));
 }
@@ -148,7 +177,7 @@ ex_pow::get_lag_min(bool stop_on_E) const
 ptr_base
 ex_pow::diff(const ptr_base &p) const
 {
-    ptr_base f = m_base, g = m_exp, fp = m_base->diff(p), gp = m_exp->diff(p);
+    ptr_base f = m_base, g = m_exp, fp = cached_diff(m_base, p), gp = cached_diff(m_exp, p);
     bool f0 = fp->is0(), g0 = gp->is0();
     if (f0 && g0) return fp;
     if (f0) return mk_mul(mk_pow(f, g), mk_mul(mk_func(LOG, f), gp));
@@ -161,6 +190,7 @@ ex_pow::diff(const ptr_base &p) const
 bool
 ex_pow::has(const ptr_base &what, search_flag f, bool exact_idx) const
 {
+    if (!may_have(*what, f)) return false;
     return m_base->has(what, f, exact_idx) || m_exp->has(what, f, exact_idx);
 }
 
@@ -35,11 +35,15 @@ class ex_pow : public ex_base {
 
     /// Constructor from two arguments.
     static ptr_base create(const ptr_base &a, const ptr_base &b);
+    /// Raw node (not hash-consed, see canon())
+    static ptr_base create_raw(const ptr_base &a, const ptr_base &b);
     /// Free memory (assumes that ptr is acutally pointer to ex_pow)
     static void destroy(ex_base *ptr);
 
     /// Comparison
     int compare(const ex_pow&) const;
+    /// Is node identical to another one (subexpressions compared by address)?
+    bool identical(const ex_pow&) const;
 
     /// String representation
     virtual std::string str(int pflag) const;
@@ -48,9 +52,9 @@ class ex_pow : public ex_base {
     /// LaTeX string representation
     virtual std::string tex(int pflag) const;
     /// Max lag in expression
-    virtual int get_lag_max(bool stop_on_E = false) const;
+    virtual int lag_max(bool stop_on_E) const;
     /// Min lag in expression
-    virtual int get_lag_min(bool stop_on_E = false) const;
+    virtual int lag_min(bool stop_on_E) const;
 
     /// Derivative wrt a variable
     virtual ptr_base diff(const ptr_base&) const;
@@ -70,6 +74,8 @@ class ex_pow : public ex_base {
     ex_pow();
     // Ops
     ptr_base m_base, m_exp;
+    // Compute hash value, signature and lags
+    void update_hash();
 
 }; /* class ex_pow */
 
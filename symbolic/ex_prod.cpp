@@ -15,6 +15,8 @@
 
 #include <ex_prod.h>
 #include <cmp.h>
+#include <diff_cache.h>
+#include <unique_table.h>
 #include <ops.h>
 #include <error.h>
 #include <utils.h>
@@ -34,6 +36,7 @@ ex_prod::ex_prod(const idx_ex &ie, const ptr_base &e)
         is.erase(m_ie.m_id);
         if (is.size()) m_type |= HASIDX;
     }
+    update_hash();
 }
 
 
@@ -42,9 +45,9 @@ ex_prod::create(const idx_ex &ie, const ptr_base &e)
 {
     if (e->is0()) return e;
     if (!e->hasidx(ie.get_id())) {
-        return mk_pow(e, ptr_base(new ex_sum(ie, ex_num::one())));
+        return mk_pow(e, unique_table::get_instance().intern(new ex_sum(ie, ex_num::one())));
     }
-    return ptr_base(new ex_prod(ie, e));
+    return unique_table::get_instance().intern(new ex_prod(ie, e));
 }
 
 
@@ -67,6 +70,7 @@ ex_prod::reindex(bool force) const
         idn = ref.append_underscore(idn);
     }
     while (m_e->hasidx(idn)) { idn = ref.append_underscore(idn); }
+    deferred_canon eager(false);
     return create(idx_ex(idn, m_ie.m_set, m_ie.m_excl_id), substidx(m_e, id, (int) idn));
 }
 
@@ -81,6 +85,22 @@ ex_prod::compare(const ex_prod &b) const
 }
 
 
+bool
+ex_prod::identical(const ex_prod &b) const
+{
+    return m_ie.identical(b.m_ie) && (m_e.get() == b.m_e.get());
+}
+
+
+void
+ex_prod::update_hash()
+{
+    m_hash = hash_mix(hash_mix(PROD, m_ie.hash()), m_e->hash());
+    m_sig = m_e->sig();
+    set_lags(*m_e);
+}
+
+
 std::string
 ex_prod::str(int pflag) const
 {
@@ -125,14 +145,14 @@ ex_prod::tex(int pflag) const
 
 
 int
-ex_prod::get_lag_max(bool stop_on_E) const
+ex_prod::lag_max(bool stop_on_E) const
 {
     return m_e->get_lag_max(stop_on_E);
 }
 
 
 int
-ex_prod::get_lag_min(bool stop_on_E) const
+ex_prod::lag_min(bool stop_on_E) const
 {
     return m_e->get_lag_min(stop_on_E);
 }
@@ -144,7 +164,7 @@ ex_prod::diff(const ptr_base &p) const
 {
     if (p->hasidx(m_ie.m_id)) return reindex(true)->diff(p);
     ptr_base cpy = create(m_ie, m_e);
-    ptr_base pder = ex_sum::create(m_ie, mk_div(m_e->diff(p), m_e));
+    ptr_base pder = ex_sum::create(m_ie, mk_div(cached_diff(m_e, p), m_e));
     return mk_mul(cpy, pder);
 }
 
@@ -152,6 +172,7 @@ ex_prod::diff(const ptr_base &p) const
 bool
 ex_prod::has(const ptr_base &what, search_flag f, bool exact_idx) const
 {
+    if (!may_have(*what, f)) return false;
     return m_e->has(what, f, exact_idx);
 }
 
@@ -166,13 +187,15 @@ ex_prod::hasidx(int idx) const
 ptr_base
 ex_prod::expand() const
 {
+    // Elements are canonicalized once after substitution and expansion
+    deferred_canon dc(deferred_phases());
     num_ex_pair_vec out;
     out.reserve(m_ie.m_set.size());
     set<unsigned>::const_iterator it;
     for (it = m_ie.m_set->begin(); it != m_ie.m_set->end(); ++it) {
         if (-m_ie.m_excl_id != (int) *it) {
             out.push_back(std::pair<Number, ptr_base>(1,
-                    symbolic::internal::expandsp(substidx(m_e, m_ie.m_id, -*it))));
+                    canon(symbolic::internal::expandsp(substidx(m_e, m_ie.m_id, -*it)))));
         }
     }
     return mk_mul(out);
@@ -44,6 +44,8 @@ class ex_prod : public ex_base {
 
     /// Comparison
     int compare(const ex_prod&) const;
+    /// Is node identical to another one (subexpressions compared by address)?
+    bool identical(const ex_prod&) const;
 
     /// String representation
     virtual std::string str(int pflag) const;
@@ -53,9 +55,9 @@ class ex_prod : public ex_base {
     /// LaTeX string representation
     virtual std::string tex(int pflag) const;
     /// Max lag in expression
-    virtual int get_lag_max(bool stop_on_E = false) const;
+    virtual int lag_max(bool stop_on_E) const;
     /// Min lag in expression
-    virtual int get_lag_min(bool stop_on_E = false) const;
+    virtual int lag_min(bool stop_on_E) const;
 
     /// Derivative wrt a variable
     virtual ptr_base diff(const ptr_base&) const;
@@ -80,6 +82,8 @@ class ex_prod : public ex_base {
     idx_ex m_ie;
     // Expression
     ptr_base m_e;
+    // Compute hash value, signature and lags
+    void update_hash();
 
     friend ptr_base substidx(const ptr_base &e, unsigned what, int with);
 
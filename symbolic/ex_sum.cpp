@@ -14,7 +14,12 @@
 
 
 #include <ex_sum.h>
+#include <ex_num.h>
+#include <ex_delta.h>
+#include <ex_mul.h>
 #include <cmp.h>
+#include <diff_cache.h>
+#include <unique_table.h>
 #include <ops.h>
 #include <error.h>
 #include <utils.h>
@@ -34,6 +39,7 @@ ex_sum::ex_sum(const idx_ex &ie, const ptr_base &e)
         is.erase(m_ie.m_id);
         if (is.size()) m_type |= HASIDX;
     }
+    update_hash();
 }
 
 
@@ -42,7 +48,7 @@ ex_sum::create(const idx_ex &ie, const ptr_base &e)
 {
     if (e->is0()) return e;
     if (!e->hasidx(ie.get_id())) {
-        return mk_mul(ptr_base(new ex_sum(ie, ex_num::one())), e);
+        return mk_mul(unique_table::get_instance().intern(new ex_sum(ie, ex_num::one())), e);
     }
     if (e->type() == ADD) {
         const num_ex_pair_vec &in = e.get<ex_add>()->get_ops();
@@ -66,10 +72,10 @@ ex_sum::create(const idx_ex &ie, const ptr_base &e)
                 out1.push_back(in[i]);
             }
         }
-        out1.push_back(num_ex_pair(1., ptr_base(new ex_sum(ie, mk_mul(out2)))));
+        out1.push_back(num_ex_pair(1., unique_table::get_instance().intern(new ex_sum(ie, mk_mul(out2)))));
         return mk_mul(out1);
     }
-    return ptr_base(new ex_sum(ie, e));
+    return unique_table::get_instance().intern(new ex_sum(ie, e));
 }
 
 
@@ -93,6 +99,7 @@ ex_sum::reindex(bool force) const
         idn = ref.append_underscore(idn);
     }
     while (m_e->hasidx(idn)) { idn = ref.append_underscore(idn); }
+    deferred_canon eager(false);
     return create(idx_ex(idn, m_ie.m_set, m_ie.m_excl_id), substidx(m_e, id, (int) idn));
 }
 
@@ -107,6 +114,22 @@ ex_sum::compare(const ex_sum &b) const
 }
 
 
+bool
+ex_sum::identical(const ex_sum &b) const
+{
+    return m_ie.identical(b.m_ie) && (m_e.get() == b.m_e.get());
+}
+
+
+void
+ex_sum::update_hash()
+{
+    m_hash = hash_mix(hash_mix(SUM, m_ie.hash()), m_e->hash());
+    m_sig = m_e->sig();
+    set_lags(*m_e);
+}
+
+
 std::string
 ex_sum::str(int pflag) const
 {
@@ -151,14 +174,14 @@ ex_sum::tex(int pflag) const
 
 
 int
-ex_sum::get_lag_max(bool stop_on_E) const
+ex_sum::lag_max(bool stop_on_E) const
 {
     return m_e->get_lag_max(stop_on_E);
 }
 
 
 int
-ex_sum::get_lag_min(bool stop_on_E) const
+ex_sum::lag_min(bool stop_on_E) const
 {
     return m_e->get_lag_min(stop_on_E);
 }
@@ -169,13 +192,14 @@ ptr_base
 ex_sum::diff(const ptr_base &p) const
 {
     if (p->hasidx(m_ie.m_id)) return reindex(true)->diff(p);
-    return create(m_ie, m_e->diff(p));
+    return create(m_ie, cached_diff(m_e, p));
 }
 
 
 bool
 ex_sum::has(const ptr_base &what, search_flag f, bool exact_idx) const
 {
+    if (!may_have(*what, f)) return false;
     return m_e->has(what, f, exact_idx);
 }
 
@@ -190,19 +214,49 @@ ex_sum::hasidx(int idx) const
 ptr_base
 ex_sum::expand() const
 {
+    // Elements are canonicalized once after substitution and expansion
+    deferred_canon dc(deferred_phases());
     num_ex_pair_vec out;
     out.reserve(m_ie.m_set.size());
     set<unsigned>::const_iterator it;
     for (it = m_ie.m_set->begin(); it != m_ie.m_set->end(); ++it) {
         if (-m_ie.m_excl_id != (int) *it) {
             out.push_back(std::pair<Number, ptr_base>(1,
-                    expandsp(substidx(m_e, m_ie.m_id, -*it))));
+                    canon(expandsp(substidx(m_e, m_ie.m_id, -*it)))));
         }
     }
     return mk_add(out);
 }
 
 
+bool
+ex_sum::expand_delta(ptr_base &res) const
+{
+    const ex_base *d = 0;
+    unsigned t = m_e->type();
+    if (t == DELTA) {
+        d = m_e.get();
+    } else if (t == MUL) {
+        const num_ex_pair_vec &in = m_e.get<ex_mul>()->get_ops();
+        for (unsigned i = 0; (i < in.size()) && !d; ++i) {
+            if ((in[i].second->type() == DELTA) && (in[i].first == 1)
+                && in[i].second->hasidx(m_ie.m_id)) d = in[i].second.get();
+        }
+    }
+    if (!d) return false;
+    const ex_delta *pd = static_cast<const ex_delta*>(d);
+    int val = (pd->get_idx1() == (int) m_ie.m_id) ? pd->get_idx2() : pd->get_idx1();
+    if (val >= 0) return false;
+    if ((val == m_ie.m_excl_id) || (m_ie.m_set->find(-val) == m_ie.m_set->end())) {
+        res = ex_num::zero();
+    } else {
+        deferred_canon dc(deferred_phases());
+        res = canon(expandsp(substidx(m_e, m_ie.m_id, val)));
+    }
+    return true;
+}
+
+
 ptr_base
 ex_sum::reduceidx(const idx_ex &ie) const
 {
@@ -227,6 +281,7 @@ ex_sum::reduceidx(const idx_ex &ie) const
                 }
             }
             if (red) {
+                deferred_canon eager(false);
                 return symbolic::internal::reduceidx(substidx(mk_mul(out), i2, i1), ie);
             }
         } else if ((t == ADD) && (f & SINGLE)) {
@@ -44,6 +44,8 @@ class ex_sum : public ex_base {
 
     /// Comparison
     int compare(const ex_sum&) const;
+    /// Is node identical to another one (subexpressions compared by address)?
+    bool identical(const ex_sum&) const;
 
     /// String representation
     virtual std::string str(int pflag) const;
@@ -53,9 +55,9 @@ class ex_sum : public ex_base {
     /// LaTeX string representation
     virtual std::string tex(int pflag) const;
     /// Max lag in expression
-    virtual int get_lag_max(bool stop_on_E = false) const;
+    virtual int lag_max(bool stop_on_E) const;
     /// Min lag in expression
-    virtual int get_lag_min(bool stop_on_E = false) const;
+    virtual int lag_min(bool stop_on_E) const;
 
     /// Derivative wrt a variable
     virtual ptr_base diff(const ptr_base&) const;
@@ -67,6 +69,10 @@ class ex_sum : public ex_base {
 
     /// Expansion
     ptr_base expand() const;
+    /// Expansion of sum with all indices fixed whose terms are guarded by
+    /// Kronecker delta of its index: only the nonzero term is built.
+    /// Returns false if sum is not of this form.
+    bool expand_delta(ptr_base &res) const;
     /// Kronecker delta reduction
     ptr_base reduceidx(const idx_ex&) const;
 
@@ -82,6 +88,8 @@ class ex_sum : public ex_base {
     idx_ex m_ie;
     // Expression
     ptr_base m_e;
+    // Compute hash value, signature and lags
+    void update_hash();
 
     friend ptr_base substidx(const ptr_base &e, unsigned what, int with);
 
@@ -17,6 +17,7 @@
 #include <stringhash.h>
 #include <utils.h>
 #include <cmp.h>
+#include <unique_table.h>
 #include <climits>
 
 
@@ -27,26 +28,28 @@ using namespace symbolic::internal;
 
 ex_symb::ex_symb(const std::string &n) : ex_base(SYMB | SINGLE)
 {
-    m_hash = stringhash::get_instance().get_hash(n);
+    m_name = stringhash::get_instance().get_hash(n);
+    update_hash();
 }
 
 ptr_base
 ex_symb::create(const std::string &n)
 {
-    return ptr_base(new ex_symb(n));
+    return unique_table::get_instance().intern(new ex_symb(n));
 }
 
 
 ex_symb::ex_symb(unsigned n) : ex_base(SYMB | SINGLE)
 {
-    m_hash = n;
+    m_name = n;
+    update_hash();
 }
 
 
 ptr_base
 ex_symb::create(unsigned n)
 {
-    return ptr_base(new ex_symb(n));
+    return unique_table::get_instance().intern(new ex_symb(n));
 }
 
 
@@ -60,14 +63,30 @@ ex_symb::destroy(ex_base *ptr)
 int
 ex_symb::compare(const ex_symb &b) const
 {
-    return compareT(m_hash, b.m_hash);
+    return compareT(m_name, b.m_name);
+}
+
+
+bool
+ex_symb::identical(const ex_symb &b) const
+{
+    return m_name == b.m_name;
+}
+
+
+void
+ex_symb::update_hash()
+{
+    m_hash = hash_mix(SYMB, m_name);
+    m_sig = sig_name(m_name);
+    set_lags();
 }
 
 
 std::string
 ex_symb::get_name() const
 {
-    return stringhash::get_instance().get_str(m_hash);
+    return stringhash::get_instance().get_str(m_name);
 }
 
 
@@ -102,14 +121,14 @@ ex_symb::tex(int pflag) const
 
 
 int
-ex_symb::get_lag_max(bool) const
+ex_symb::lag_max(bool) const
 {
     return INT_MIN;
 }
 
 
 int
-ex_symb::get_lag_min(bool) const
+ex_symb::lag_min(bool) const
 {
     return INT_MAX;
 }
@@ -130,7 +149,7 @@ ex_symb::has(const ptr_base &what, search_flag f, bool) const
 {
     if (what->type() != SYMB) return false;
     const ex_symb *w = what.get<ex_symb>();
-    if (compareT(m_hash, w->m_hash)) return false;
+    if (compareT(m_name, w->m_name)) return false;
     switch (f) {
         case EXACT_T:
         case ANY_T:
@@ -38,6 +38,8 @@ class ex_symb : public ex_base {
 
     /// Comparison
     int compare(const ex_symb&) const;
+    /// Is node identical to another one (subexpressions compared by address)?
+    bool identical(const ex_symb&) const;
 
     /// Get name
     std::string get_name() const;
@@ -50,9 +52,9 @@ class ex_symb : public ex_base {
     virtual std::string tex(int pflag) const;
 
     /// Max lag in expression
-    virtual int get_lag_max(bool stop_on_E = false) const;
+    virtual int lag_max(bool stop_on_E) const;
     /// Min lag in expression
-    virtual int get_lag_min(bool stop_on_E = false) const;
+    virtual int lag_min(bool stop_on_E) const;
 
     /// Derivative wrt a variable
     virtual ptr_base diff(const ptr_base&) const;
@@ -69,6 +71,10 @@ class ex_symb : public ex_base {
     ex_symb(unsigned n);
     // Constructor from hash values
     static ptr_base create(unsigned n);
+    // Name (hash value of string)
+    unsigned m_name;
+    // Compute hash value, signature and lags
+    void update_hash();
 
     friend ptr_base append_name(const ptr_base &p, const std::string &s);
     friend ptr_base add_idx(const ptr_base &e, const idx_ex &ie);
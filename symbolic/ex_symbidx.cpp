@@ -18,6 +18,7 @@
 #include <stringhash.h>
 #include <utils.h>
 #include <cmp.h>
+#include <unique_table.h>
 #include <climits>
 
 
@@ -32,7 +33,7 @@ ex_symbidx::ex_symbidx(const std::string &n,
                         : ex_base(SYMBIDX | SINGLE)
 {
     stringhash &ref = stringhash::get_instance();
-    m_hash = ref.get_hash(n);
+    m_name = ref.get_hash(n);
     m_idx1 = ref.get_hash(i1);
     if (fixed1) m_idx1 = -m_idx1;
     m_idx2 = 0;
@@ -40,6 +41,7 @@ ex_symbidx::ex_symbidx(const std::string &n,
     m_idx4 = 0;
     m_noid = 1;
     if (!fixed1) m_type |= HASIDX;
+    update_hash();
 }
 
 
@@ -49,7 +51,7 @@ ex_symbidx::ex_symbidx(const std::string &n,
                         : ex_base(SYMBIDX | SINGLE)
 {
     stringhash &ref = stringhash::get_instance();
-    m_hash = ref.get_hash(n);
+    m_name = ref.get_hash(n);
     m_idx1 = ref.get_hash(i1);
     if (fixed1) m_idx1 = -m_idx1;
     m_idx2 = ref.get_hash(i2);
@@ -58,6 +60,7 @@ ex_symbidx::ex_symbidx(const std::string &n,
     m_idx4 = 0;
     m_noid = 2;
     if (!fixed1 || !fixed2) m_type |= HASIDX;
+    update_hash();
 }
 
 
@@ -68,7 +71,7 @@ ex_symbidx::ex_symbidx(const std::string &n,
                         : ex_base(SYMBIDX | SINGLE)
 {
     stringhash &ref = stringhash::get_instance();
-    m_hash = ref.get_hash(n);
+    m_name = ref.get_hash(n);
     m_idx1 = ref.get_hash(i1);
     if (fixed1) m_idx1 = -m_idx1;
     m_idx2 = ref.get_hash(i2);
@@ -78,6 +81,7 @@ ex_symbidx::ex_symbidx(const std::string &n,
     m_idx4 = 0;
     m_noid = 3;
     if (!fixed1 || !fixed2 || !fixed3) m_type |= HASIDX;
+    update_hash();
 }
 
 
@@ -89,7 +93,7 @@ ex_symbidx::ex_symbidx(const std::string &n,
                         : ex_base(SYMBIDX | SINGLE)
 {
     stringhash &ref = stringhash::get_instance();
-    m_hash = ref.get_hash(n);
+    m_name = ref.get_hash(n);
     m_idx1 = ref.get_hash(i1);
     if (fixed1) m_idx1 = -m_idx1;
     m_idx2 = ref.get_hash(i2);
@@ -100,6 +104,7 @@ ex_symbidx::ex_symbidx(const std::string &n,
     if (fixed4) m_idx4 = -m_idx4;
     m_noid = 4;
     if (!fixed1 || !fixed2 || !fixed3 || !fixed4) m_type |= HASIDX;
+    update_hash();
 }
 
 
@@ -107,7 +112,7 @@ ptr_base
 ex_symbidx::create(const std::string &n,
                    bool fixed1, const std::string &i1)
 {
-    return ptr_base(new ex_symbidx(n, fixed1, i1));
+    return unique_table::get_instance().intern(new ex_symbidx(n, fixed1, i1));
 }
 
 
@@ -116,7 +121,7 @@ ex_symbidx::create(const std::string &n,
                    bool fixed1, const std::string &i1,
                    bool fixed2, const std::string &i2)
 {
-    return ptr_base(new ex_symbidx(n, fixed1, i1, fixed2, i2));
+    return unique_table::get_instance().intern(new ex_symbidx(n, fixed1, i1, fixed2, i2));
 }
 
 
@@ -126,7 +131,7 @@ ex_symbidx::create(const std::string &n,
                    bool fixed2, const std::string &i2,
                    bool fixed3, const std::string &i3)
 {
-    return ptr_base(new ex_symbidx(n, fixed1, i1, fixed2, i2, fixed3, i3));
+    return unique_table::get_instance().intern(new ex_symbidx(n, fixed1, i1, fixed2, i2, fixed3, i3));
 }
 
 
@@ -137,8 +142,8 @@ ex_symbidx::create(const std::string &n,
                    bool fixed3, const std::string &i3,
                    bool fixed4, const std::string &i4)
 {
-    return ptr_base(new ex_symbidx(n, fixed1, i1, fixed2, i2, fixed3, i3,
-                                   fixed4, i4));
+    return unique_table::get_instance().intern(new ex_symbidx(n, fixed1, i1, fixed2, i2, fixed3, i3,
+                                                              fixed4, i4));
 }
 
 
@@ -146,20 +151,21 @@ ex_symbidx::create(const std::string &n,
 ex_symbidx::ex_symbidx(unsigned n, unsigned no, int i1, int i2, int i3, int i4)
                         : ex_base(SYMBIDX | SINGLE)
 {
-    m_hash = n;
+    m_name = n;
     m_noid = no;
     m_idx1 = i1;
     m_idx2 = i2;
     m_idx3 = i3;
     m_idx4 = i4;
     if ((i1 > 0) || (i2 > 0) || (i3 > 0) || (i4 > 0)) m_type |= HASIDX;
+    update_hash();
 }
 
 
 ptr_base
 ex_symbidx::create(unsigned n, unsigned no, int i1, int i2, int i3, int i4)
 {
-    return ptr_base(new ex_symbidx(n, no, i1, i2, i3, i4));
+    return unique_table::get_instance().intern(new ex_symbidx(n, no, i1, i2, i3, i4));
 }
 
 
@@ -175,7 +181,7 @@ int
 ex_symbidx::compare(const ex_symbidx &b) const
 {
     int t;
-    if ((t = compareT(m_hash, b.m_hash))) return t;
+    if ((t = compareT(m_name, b.m_name))) return t;
     if ((t = compareT(m_noid, b.m_noid))) return t;
     if ((t = compareT(m_idx1, b.m_idx1))) return ((m_idx1 < 0) && (b.m_idx1 < 0)) ? -t : t;
     if ((t = compareT(m_idx2, b.m_idx2))) return ((m_idx2 < 0) && (b.m_idx2 < 0)) ? -t : t;
@@ -185,10 +191,33 @@ ex_symbidx::compare(const ex_symbidx &b) const
 }
 
 
+bool
+ex_symbidx::identical(const ex_symbidx &b) const
+{
+    return (m_name == b.m_name) && (m_noid == b.m_noid)
+           && (m_idx1 == b.m_idx1) && (m_idx2 == b.m_idx2)
+           && (m_idx3 == b.m_idx3) && (m_idx4 == b.m_idx4);
+}
+
+
+void
+ex_symbidx::update_hash()
+{
+    unsigned h = hash_mix(SYMBIDX, m_name);
+    h = hash_mix(h, m_noid);
+    h = hash_mix(h, (unsigned) m_idx1);
+    h = hash_mix(h, (unsigned) m_idx2);
+    h = hash_mix(h, (unsigned) m_idx3);
+    m_hash = hash_mix(h, (unsigned) m_idx4);
+    m_sig = sig_name(m_name);
+    set_lags();
+}
+
+
 std::string
 ex_symbidx::get_name() const
 {
-    return stringhash::get_instance().get_str(m_hash);
+    return stringhash::get_instance().get_str(m_name);
 }
 
 
@@ -334,14 +363,14 @@ if (id < 0) { \
 
 
 int
-ex_symbidx::get_lag_max(bool) const
+ex_symbidx::lag_max(bool) const
 {
     return INT_MIN;
 }
 
 
 int
-ex_symbidx::get_lag_min(bool) const
+ex_symbidx::lag_min(bool) const
 {
     return INT_MAX;
 }
@@ -352,7 +381,7 @@ ex_symbidx::diff(const ptr_base &p) const
 {
     if (p->type() != SYMBIDX) return ex_num::zero();
     const ex_symbidx *pp = p.get<ex_symbidx>();
-    if (m_hash != pp->m_hash) return ex_num::zero();
+    if (m_name != pp->m_name) return ex_num::zero();
     if (m_noid != pp->m_noid) return ex_num::zero();
     ptr_base res = ex_delta::create(m_idx1, pp->m_idx1);
     if (m_noid > 1) { res = mk_mul(res, ex_delta::create(m_idx2, pp->m_idx2)); }
@@ -368,7 +397,7 @@ ex_symbidx::has(const ptr_base &what, search_flag f, bool exact_idx) const
 {
     if (what->type() != SYMBIDX) return false;
     const ex_symbidx *w = what.get<ex_symbidx>();
-    if (compareT(m_hash, w->m_hash)) return false;
+    if (compareT(m_name, w->m_name)) return false;
     if (compareT(m_noid, w->m_noid)) return false;
     if (exact_idx) {
         if (compareT(m_idx1, w->m_idx1)) return false;
@@ -416,7 +445,7 @@ ex_symbidx::substidx(unsigned what, int with) const
     i2 = (m_idx2 == (int) what) ? with : m_idx2;
     i3 = (m_idx3 == (int) what) ? with : m_idx3;
     i4 = (m_idx4 == (int) what) ? with : m_idx4;
-    return create(m_hash, m_noid, i1, i2, i3, i4);
+    return create(m_name, m_noid, i1, i2, i3, i4);
 }
 
 
@@ -66,6 +66,8 @@ class ex_symbidx : public ex_base {
 
     /// Comparison
     int compare(const ex_symbidx&) const;
+    /// Is node identical to another one (subexpressions compared by address)?
+    bool identical(const ex_symbidx&) const;
 
     /// Get name
     std::string get_name() const;
@@ -77,9 +79,9 @@ class ex_symbidx : public ex_base {
     /// LaTeX string representation
     virtual std::string tex(int pflag) const;
     /// Max lag in expression
-    virtual int get_lag_max(bool stop_on_E = false) const;
+    virtual int lag_max(bool stop_on_E) const;
     /// Min lag in expression
-    virtual int get_lag_min(bool stop_on_E = false) const;
+    virtual int lag_min(bool stop_on_E) const;
 
     /// Derivative wrt a variable
     virtual ptr_base diff(const ptr_base&) const;
@@ -98,15 +100,22 @@ class ex_symbidx : public ex_base {
     static ptr_base create(unsigned n, unsigned no, int i1, int i2, int i3, int i4);
     // Index substitution
     ptr_base substidx(unsigned what, int with) const;
+    // Name (hash value of string)
+    unsigned m_name;
     // Indices
     unsigned m_noid;
     int m_idx1, m_idx2, m_idx3, m_idx4;
+    // Compute hash value, signature and lags
+    void update_hash();
 
     friend ptr_base append_name(const ptr_base &p, const std::string &s);
     friend ptr_base add_idx(const ptr_base &e, const idx_ex &ie);
     friend ptr_base subst(const ptr_base &e, const ptr_base &what,
                           const ptr_base &with, bool all_leads_lags);
     friend ptr_base substidx(const ptr_base &e, unsigned what, int with);
+    friend ptr_base substidx(const ptr_base &e, const idx_ren &iv);
+    friend ptr_base free_idx(const ptr_base &p, idx_ren &iv);
+    friend unsigned hash_idx(const ptr_base &p, const idx_ren &ren);
     friend void collect_idx(const ptr_base &p, std::set<unsigned> &iset);
 
 }; /* class ex_symbidx */
@@ -17,6 +17,7 @@
 #include <ex_num.h>
 #include <ops.h>
 #include <cmp.h>
+#include <unique_table.h>
 #include <stringhash.h>
 #include <utils.h>
 #include <climits>
@@ -28,13 +29,15 @@ using namespace symbolic::internal;
 ex_vart::ex_vart(const std::string &n, int l)
     : ex_base(VART | ((l == INT_MIN) ? 0 : HAST) | SINGLE), m_lag(l)
 {
-    m_hash = stringhash::get_instance().get_hash(n);
+    m_name = stringhash::get_instance().get_hash(n);
+    update_hash();
 }
 
 ex_vart::ex_vart(unsigned i, int l)
     : ex_base(VART | ((l == INT_MIN) ? 0 : HAST) | SINGLE), m_lag(l)
 {
-    m_hash = i;
+    m_name = i;
+    update_hash();
 }
 
 
@@ -42,14 +45,14 @@ ex_vart::ex_vart(unsigned i, int l)
 ptr_base
 ex_vart::create(const std::string &n, int l)
 {
-    return ptr_base(new ex_vart(n, l));
+    return unique_table::get_instance().intern(new ex_vart(n, l));
 }
 
 
 ptr_base
 ex_vart::create(unsigned i, int l)
 {
-    return ptr_base(new ex_vart(i, l));
+    return unique_table::get_instance().intern(new ex_vart(i, l));
 }
 
 void
@@ -62,7 +65,7 @@ ex_vart::destroy(ex_base *ptr)
 ptr_base
 ex_vart::copy0() const
 {
-    return ptr_base(new ex_vart(m_hash, 0));
+    return unique_table::get_instance().intern(new ex_vart(m_name, 0));
 }
 
 
@@ -71,14 +74,30 @@ ex_vart::compare(const ex_vart &b) const
 {
     if (m_lag < b.m_lag) return -1;
     if (m_lag > b.m_lag) return 1;
-    return compareT(m_hash, b.m_hash);
+    return compareT(m_name, b.m_name);
+}
+
+
+bool
+ex_vart::identical(const ex_vart &b) const
+{
+    return (m_name == b.m_name) && (m_lag == b.m_lag);
+}
+
+
+void
+ex_vart::update_hash()
+{
+    m_hash = hash_mix(hash_mix(VART, m_name), (unsigned) m_lag);
+    m_sig = sig_name(m_name) | sig_lag(m_lag);
+    set_lags(m_lag);
 }
 
 
 int
 ex_vart::compare_name(const ex_vart &b) const
 {
-    return compareT(m_hash, b.m_hash);
+    return compareT(m_name, b.m_name);
 }
 
 
@@ -86,7 +105,7 @@ ex_vart::compare_name(const ex_vart &b) const
 std::string
 ex_vart::get_name() const
 {
-    return stringhash::get_instance().get_str(m_hash);
+    return stringhash::get_instance().get_str(m_name);
 }
 
 
@@ -141,14 +160,14 @@ ex_vart::tex(int pflag) const
 
 
 int
-ex_vart::get_lag_max(bool) const
+ex_vart::lag_max(bool) const
 {
     return m_lag;
 }
 
 
 int
-ex_vart::get_lag_min(bool) const
+ex_vart::lag_min(bool) const
 {
     if (m_lag == INT_MIN) return INT_MAX;
     return m_lag;
@@ -172,7 +191,7 @@ ex_vart::has(const ptr_base &what, search_flag f, bool) const
 {
     if (what->type() != VART) return false;
     const ex_vart *w = what.get<ex_vart>();
-    if (compareT(m_hash, w->m_hash)) return false;
+    if (compareT(m_name, w->m_name)) return false;
     switch (f) {
         case EXACT_T:
             return (m_lag == w->m_lag) ? true : false;
@@ -202,8 +221,8 @@ ex_vart::hasidx(int) const
 ptr_base
 ex_vart::lag(int l) const
 {
-    if (l == INT_MIN) return create(m_hash, l);
-    return create(m_hash, m_lag + l);
+    if (l == INT_MIN) return create(m_name, l);
+    return create(m_name, m_lag + l);
 }
 
 
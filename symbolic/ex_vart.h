@@ -41,6 +41,8 @@ class ex_vart : public ex_base {
 
     /// Comparison
     int compare(const ex_vart&) const;
+    /// Is node identical to another one (subexpressions compared by address)?
+    bool identical(const ex_vart&) const;
     /// Name comparison
     int compare_name(const ex_vart&) const;
 
@@ -55,9 +57,9 @@ class ex_vart : public ex_base {
     /// LaTeX string representation
     virtual std::string tex(int pflag) const;
     /// Max lag in expression
-    virtual int get_lag_max(bool stop_on_E = false) const;
+    virtual int lag_max(bool stop_on_E) const;
     /// Min lag in expression
-    virtual int get_lag_min(bool stop_on_E = false) const;
+    virtual int lag_min(bool stop_on_E) const;
 
     /// Derivative w.r.t. a variable
     virtual ptr_base diff(const ptr_base&) const;
@@ -79,8 +81,12 @@ class ex_vart : public ex_base {
     ex_vart(unsigned i, int l);
     // Constructor given hash and lag
     static ptr_base create(unsigned i, int l);
+    // Name (hash value of string)
+    unsigned m_name;
     // Lag
     int m_lag;
+    // Compute hash value, signature and lags
+    void update_hash();
 
     friend ptr_base append_name(const ptr_base &p, const std::string &s);
     friend ptr_base add_idx(const ptr_base &e, const idx_ex &ie);
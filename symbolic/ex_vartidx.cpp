@@ -17,6 +17,7 @@
 #include <ex_num.h>
 #include <ops.h>
 #include <cmp.h>
+#include <unique_table.h>
 #include <stringhash.h>
 #include <utils.h>
 #include <climits>
@@ -31,7 +32,7 @@ ex_vartidx::ex_vartidx(const std::string &n, int l,
     : ex_base(VARTIDX | ((l == INT_MIN) ? 0 : HAST) | SINGLE), m_lag(l)
 {
     stringhash &ref = stringhash::get_instance();
-    m_hash = ref.get_hash(n);
+    m_name = ref.get_hash(n);
     m_idx1 = ref.get_hash(i1);
     if (fixed1) m_idx1 = -m_idx1;
     m_idx2 = 0;
@@ -39,6 +40,7 @@ ex_vartidx::ex_vartidx(const std::string &n, int l,
     m_idx4 = 0;
     m_noid = 1;
     if (!fixed1) m_type |= HASIDX;
+    update_hash();
 }
 
 
@@ -48,7 +50,7 @@ ex_vartidx::ex_vartidx(const std::string &n, int l,
     : ex_base(VARTIDX | ((l == INT_MIN) ? 0 : HAST) | SINGLE), m_lag(l)
 {
     stringhash &ref = stringhash::get_instance();
-    m_hash = ref.get_hash(n);
+    m_name = ref.get_hash(n);
     m_idx1 = ref.get_hash(i1);
     if (fixed1) m_idx1 = -m_idx1;
     m_idx2 = ref.get_hash(i2);
@@ -57,6 +59,7 @@ ex_vartidx::ex_vartidx(const std::string &n, int l,
     m_idx4 = 0;
     m_noid = 2;
     if (!fixed1 || !fixed2) m_type |= HASIDX;
+    update_hash();
 }
 
 
@@ -67,7 +70,7 @@ ex_vartidx::ex_vartidx(const std::string &n, int l,
     : ex_base(VARTIDX | ((l == INT_MIN) ? 0 : HAST) | SINGLE), m_lag(l)
 {
     stringhash &ref = stringhash::get_instance();
-    m_hash = ref.get_hash(n);
+    m_name = ref.get_hash(n);
     m_idx1 = ref.get_hash(i1);
     if (fixed1) m_idx1 = -m_idx1;
     m_idx2 = ref.get_hash(i2);
@@ -77,6 +80,7 @@ ex_vartidx::ex_vartidx(const std::string &n, int l,
     m_idx4 = 0;
     m_noid = 3;
     if (!fixed1 || !fixed2 || !fixed3) m_type |= HASIDX;
+    update_hash();
 }
 
 
@@ -88,7 +92,7 @@ ex_vartidx::ex_vartidx(const std::string &n, int l,
     : ex_base(VARTIDX | ((l == INT_MIN) ? 0 : HAST) | SINGLE), m_lag(l)
 {
     stringhash &ref = stringhash::get_instance();
-    m_hash = ref.get_hash(n);
+    m_name = ref.get_hash(n);
     m_idx1 = ref.get_hash(i1);
     if (fixed1) m_idx1 = -m_idx1;
     m_idx2 = ref.get_hash(i2);
@@ -99,19 +103,21 @@ ex_vartidx::ex_vartidx(const std::string &n, int l,
     if (fixed4) m_idx4 = -m_idx4;
     m_noid = 4;
     if (!fixed1 || !fixed2 || !fixed3 || !fixed4) m_type |= HASIDX;
+    update_hash();
 }
 
 
 ex_vartidx::ex_vartidx(unsigned n, int l, unsigned no, int i1, int i2, int i3, int i4)
     : ex_base(VARTIDX | ((l == INT_MIN) ? 0 : HAST) | SINGLE), m_lag(l)
 {
-    m_hash = n;
+    m_name = n;
     m_noid = no;
     m_idx1 = i1;
     m_idx2 = i2;
     m_idx3 = i3;
     m_idx4 = i4;
     if ((i1 > 0) || (i2 > 0) || (i3 > 0) || (i4 > 0)) m_type |= HASIDX;
+    update_hash();
 }
 
 
@@ -120,7 +126,7 @@ ptr_base
 ex_vartidx::create(const std::string &n, int l,
                    bool fixed1, const std::string &i1)
 {
-    return ptr_base(new ex_vartidx(n, l, fixed1, i1));
+    return unique_table::get_instance().intern(new ex_vartidx(n, l, fixed1, i1));
 }
 
 
@@ -130,7 +136,7 @@ ex_vartidx::create(const std::string &n, int l,
                    bool fixed1, const std::string &i1,
                    bool fixed2, const std::string &i2)
 {
-    return ptr_base(new ex_vartidx(n, l, fixed1, i1, fixed2, i2));
+    return unique_table::get_instance().intern(new ex_vartidx(n, l, fixed1, i1, fixed2, i2));
 }
 
 
@@ -141,7 +147,7 @@ ex_vartidx::create(const std::string &n, int l,
                    bool fixed2, const std::string &i2,
                    bool fixed3, const std::string &i3)
 {
-    return ptr_base(new ex_vartidx(n, l, fixed1, i1, fixed2, i2, fixed3, i3));
+    return unique_table::get_instance().intern(new ex_vartidx(n, l, fixed1, i1, fixed2, i2, fixed3, i3));
 }
 
 
@@ -153,15 +159,15 @@ ex_vartidx::create(const std::string &n, int l,
                    bool fixed3, const std::string &i3,
                    bool fixed4, const std::string &i4)
 {
-    return ptr_base(new ex_vartidx(n, l, fixed1, i1, fixed2, i2, fixed3, i3,
-                                   fixed4, i4));
+    return unique_table::get_instance().intern(new ex_vartidx(n, l, fixed1, i1, fixed2, i2, fixed3, i3,
+                                                              fixed4, i4));
 }
 
 
 ptr_base
 ex_vartidx::create(unsigned n, int l, unsigned no, int i1, int i2, int i3, int i4)
 {
-    return ptr_base(new ex_vartidx(n, l, no, i1, i2, i3, i4));
+    return unique_table::get_instance().intern(new ex_vartidx(n, l, no, i1, i2, i3, i4));
 }
 
 void
@@ -174,8 +180,8 @@ ex_vartidx::destroy(ex_base *ptr)
 ptr_base
 ex_vartidx::copy0() const
 {
-    return ptr_base(new ex_vartidx(m_hash, 0,
-                                   m_noid, m_idx1, m_idx2, m_idx3, m_idx4));
+    return unique_table::get_instance().intern(new ex_vartidx(m_name, 0,
+                                                              m_noid, m_idx1, m_idx2, m_idx3, m_idx4));
 }
 
 
@@ -184,7 +190,7 @@ ex_vartidx::compare(const ex_vartidx &b) const
 {
     int t;
     if ((t = compareT(m_lag, b.m_lag))) return t;
-    if ((t = compareT(m_hash, b.m_hash))) return t;
+    if ((t = compareT(m_name, b.m_name))) return t;
     if ((t = compareT(m_noid, b.m_noid))) return t;
     if ((t = compareT(m_idx1, b.m_idx1))) return ((m_idx1 < 0) && (b.m_idx1 < 0)) ? -t : t;
     if ((t = compareT(m_idx2, b.m_idx2))) return ((m_idx2 < 0) && (b.m_idx2 < 0)) ? -t : t;
@@ -194,10 +200,33 @@ ex_vartidx::compare(const ex_vartidx &b) const
 }
 
 
+bool
+ex_vartidx::identical(const ex_vartidx &b) const
+{
+    return (m_name == b.m_name) && (m_lag == b.m_lag) && (m_noid == b.m_noid)
+           && (m_idx1 == b.m_idx1) && (m_idx2 == b.m_idx2)
+           && (m_idx3 == b.m_idx3) && (m_idx4 == b.m_idx4);
+}
+
+
+void
+ex_vartidx::update_hash()
+{
+    unsigned h = hash_mix(hash_mix(VARTIDX, m_name), (unsigned) m_lag);
+    h = hash_mix(h, m_noid);
+    h = hash_mix(h, (unsigned) m_idx1);
+    h = hash_mix(h, (unsigned) m_idx2);
+    h = hash_mix(h, (unsigned) m_idx3);
+    m_hash = hash_mix(h, (unsigned) m_idx4);
+    m_sig = sig_name(m_name) | sig_lag(m_lag);
+    set_lags(m_lag);
+}
+
+
 int
 ex_vartidx::compare_name(const ex_vartidx &b) const
 {
-    return compareT(m_hash, b.m_hash);
+    return compareT(m_name, b.m_name);
 }
 
 
@@ -205,7 +234,7 @@ ex_vartidx::compare_name(const ex_vartidx &b) const
 std::string
 ex_vartidx::get_name() const
 {
-    return stringhash::get_instance().get_str(m_hash);
+    return stringhash::get_instance().get_str(m_name);
 }
 
 
@@ -314,14 +343,14 @@ if (id < 0) { res += str2tex(ref.get_str(-id), false); \
 
 
 int
-ex_vartidx::get_lag_max(bool) const
+ex_vartidx::lag_max(bool) const
 {
     return m_lag;
 }
 
 
 int
-ex_vartidx::get_lag_min(bool) const
+ex_vartidx::lag_min(bool) const
 {
     if (m_lag == INT_MIN) return INT_MAX;
     return m_lag;
@@ -333,7 +362,7 @@ ex_vartidx::diff(const ptr_base &p) const
 {
     if (p->type() != VARTIDX) return ex_num::zero();
     const ex_vartidx *pp = p.get<ex_vartidx>();
-    if (m_hash != pp->m_hash) return ex_num::zero();
+    if (m_name != pp->m_name) return ex_num::zero();
     if (m_noid != pp->m_noid) return ex_num::zero();
     if (m_lag != pp->m_lag) return ex_num::zero();
     ptr_base res = ex_delta::create(m_idx1, pp->m_idx1);
@@ -350,7 +379,7 @@ ex_vartidx::has(const ptr_base &what, search_flag f, bool exact_idx) const
 {
     if (what->type() != VARTIDX) return false;
     const ex_vartidx *w = what.get<ex_vartidx>();
-    if (compareT(m_hash, w->m_hash)) return false;
+    if (compareT(m_name, w->m_name)) return false;
     if (compareT(m_noid, w->m_noid)) return false;
     if (exact_idx) {
         if (compareT(m_idx1, w->m_idx1)) return false;
@@ -402,15 +431,15 @@ ex_vartidx::substidx(unsigned what, int with) const
     i2 = (m_idx2 == (int) what) ? with : m_idx2;
     i3 = (m_idx3 == (int) what) ? with : m_idx3;
     i4 = (m_idx4 == (int) what) ? with : m_idx4;
-    return create(m_hash, m_lag, m_noid, i1, i2, i3, i4);
+    return create(m_name, m_lag, m_noid, i1, i2, i3, i4);
 }
 
 
 ptr_base
 ex_vartidx::lag(int l) const
 {
-    if (l == INT_MIN) return create(m_hash, l, m_noid, m_idx1, m_idx2, m_idx3, m_idx4);
-    return create(m_hash, m_lag + l, m_noid, m_idx1, m_idx2, m_idx3, m_idx4);
+    if (l == INT_MIN) return create(m_name, l, m_noid, m_idx1, m_idx2, m_idx3, m_idx4);
+    return create(m_name, m_lag + l, m_noid, m_idx1, m_idx2, m_idx3, m_idx4);
 }
 
 
@@ -73,6 +73,8 @@ class ex_vartidx : public ex_base {
 
     /// Comparison
     int compare(const ex_vartidx&) const;
+    /// Is node identical to another one (subexpressions compared by address)?
+    bool identical(const ex_vartidx&) const;
     /// Name comparison
     int compare_name(const ex_vartidx&) const;
 
@@ -87,9 +89,9 @@ class ex_vartidx : public ex_base {
     /// LaTeX string representation
     virtual std::string tex(int pflag) const;
     /// Max lag in expression
-    virtual int get_lag_max(bool stop_on_E = false) const;
+    virtual int lag_max(bool stop_on_E) const;
     /// Min lag in expression
-    virtual int get_lag_min(bool stop_on_E = false) const;
+    virtual int lag_min(bool stop_on_E) const;
 
     /// Derivative w.r.t. a variable
     virtual ptr_base diff(const ptr_base&) const;
@@ -114,11 +116,15 @@ class ex_vartidx : public ex_base {
                            unsigned no, int i1, int i2, int i3, int i4);
     // Index substitution
     ptr_base substidx(unsigned what, int with) const;
+    // Name (hash value of string)
+    unsigned m_name;
     // Lag
     int m_lag;
     // Indices
     unsigned m_noid;
     int m_idx1, m_idx2, m_idx3, m_idx4;
+    // Compute hash value, signature and lags
+    void update_hash();
 
     friend void collect_idx(const ptr_base &p, std::set<unsigned> &iset);
     friend ptr_base append_name(const ptr_base &p, const std::string &s);
@@ -126,6 +132,9 @@ class ex_vartidx : public ex_base {
     friend ptr_base subst(const ptr_base &e, const ptr_base &what,
                           const ptr_base &with, bool all_leads_lags);
     friend ptr_base substidx(const ptr_base &e, unsigned what, int with);
+    friend ptr_base substidx(const ptr_base &e, const idx_ren &iv);
+    friend ptr_base free_idx(const ptr_base &p, idx_ren &iv);
+    friend unsigned hash_idx(const ptr_base &p, const idx_ren &ren);
     friend ptr_base lag0(const ptr_base &e);
 
 }; /* class ex_vartidx */
@@ -0,0 +1,66 @@
+/*****************************************************************************
+ * This file is a part of gEcon.                                             *
+ *                                                                           *
+ * (c) Chancellery of the Prime Minister of the Republic of Poland 2012-2015 *
+ * (c) Grzegorz Klima, Karol Podemski, Kaja Retkiewicz-Wijtiwiak 2015-2016   *
+ * License terms can be found in the file 'LICENCE'                          *
+ *                                                                           *
+ * Author: Grzegorz Klima                                                    *
+ *****************************************************************************/
+
+/** \file expansion_cache.cpp
+ * \brief Memo table for expansions of indexed expressions.
+ */
+
+
+#include <expansion_cache.h>
+#include <ex_base.h>
+
+
+using namespace symbolic;
+using namespace symbolic::internal;
+
+
+namespace {
+
+// Max number of expressions in stored expansions
+const unsigned max_exprs = 1u << 22;
+
+} /* namespace */
+
+
+
+expansion_cache::expansion_cache() : m_exprs(0)
+{
+}
+
+
+
+bool
+expansion_cache::find(const ptr_base &e, vec_ex &res)
+{
+    std::unordered_map<const ex_base*, entry>::const_iterator it = m_map.find(e.get());
+    if (it == m_map.end()) return false;
+    res = it->second.second;
+    return true;
+}
+
+
+
+void
+expansion_cache::insert(const ptr_base &e, const vec_ex &res)
+{
+    if (m_exprs + res.size() > max_exprs) clear();
+    if (m_map.insert(std::make_pair(e.get(), entry(e, res))).second) m_exprs += res.size();
+}
+
+
+
+void
+expansion_cache::clear()
+{
+    std::unordered_map<const ex_base*, entry> map;
+    // Entries are released here, before the table is reused
+    m_map.swap(map);
+    m_exprs = 0;
+}
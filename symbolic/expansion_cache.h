@@ -0,0 +1,72 @@
+/*****************************************************************************
+ * This file is a part of gEcon.                                             *
+ *                                                                           *
+ * (c) Chancellery of the Prime Minister of the Republic of Poland 2012-2015 *
+ * (c) Grzegorz Klima, Karol Podemski, Kaja Retkiewicz-Wijtiwiak 2015-2016   *
+ * License terms can be found in the file 'LICENCE'                          *
+ *                                                                           *
+ * Author: Grzegorz Klima                                                    *
+ *****************************************************************************/
+
+/** \file expansion_cache.h
+ * \brief Memo table for expansions of indexed expressions.
+ */
+
+#ifndef SYMBOLIC_EXPANSION_CACHE_H
+
+#define SYMBOLIC_EXPANSION_CACHE_H
+
+#include <ex.h>
+#include <unordered_map>
+
+
+namespace symbolic {
+namespace internal {
+
+
+/// Singleton class memoizing expansions of indexed expressions, so that
+/// an equation (with indexing of its block) is expanded once although
+/// it is used in many phases of model processing. Indexed expressions
+/// are unique (hash-consed), so entries are keyed by the address of
+/// the expression. Entries hold references to their keys, so addresses
+/// cannot be reused while the entry lives. When the number of stored
+/// expressions reaches its bound the table is flushed.
+class expansion_cache
+{
+  public:
+    /// Find expansion of e, returns false if not in the cache.
+    bool find(const ptr_base &e, vec_ex &res);
+    /// Store expansion of e.
+    void insert(const ptr_base &e, const vec_ex &res);
+    /// Drop all entries.
+    void clear();
+    /// Number of entries
+    unsigned size() const { return m_map.size(); }
+    /// Get instance
+    static expansion_cache& get_instance()
+    {
+        // Never destroyed, like the unique table
+        static expansion_cache *instance = new expansion_cache;
+        return *instance;
+    }
+
+  private:
+    // Expression and its expansion
+    typedef std::pair<ptr_base, vec_ex> entry;
+    // Table
+    std::unordered_map<const ex_base*, entry> m_map;
+    // Number of expressions in expansions
+    unsigned m_exprs;
+    // Constructor is private
+    expansion_cache();
+    // Private, too. Not implemented.
+    expansion_cache(expansion_cache const& copy);
+    expansion_cache& operator=(expansion_cache const& copy);
+
+}; /* class expansion_cache */
+
+
+} /* namespace internal */
+} /* namespace symbolic */
+
+#endif /* SYMBOLIC_EXPANSION_CACHE_H */
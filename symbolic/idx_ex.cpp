@@ -20,6 +20,7 @@
 #include <ex.h>
 #include <stringhash.h>
 #include <cmp.h>
+#include <unique_table.h>
 #include <iostream>
 
 
@@ -137,6 +138,23 @@ idx_ex::compare(const idx_ex &ie, bool strict) const
 }
 
 
+unsigned
+idx_ex::hash(bool strict) const
+{
+    unsigned h = (m_set.m_p) ? m_set.m_p->m_name : 0;
+    if (strict) h = hash_mix(h, m_id);
+    return hash_mix(h, (unsigned) m_excl_id);
+}
+
+
+bool
+idx_ex::identical(const idx_ex &ie) const
+{
+    return (m_set.m_p == ie.m_set.m_p) && (m_id == ie.m_id)
+           && (m_excl_id == ie.m_excl_id);
+}
+
+
 
 std::ostream&
 symbolic::operator<<(std::ostream &os, const idx_ex &ie)
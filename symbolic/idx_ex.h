@@ -40,8 +40,6 @@ class idx_ex {
     idx_ex(const string &id, idx_set is, const string &exclid, bool fixed = false);
     /// Constructor
     idx_ex(const char *id, idx_set is, const char *exclid, bool fixed = false);
-    /// Destructor
-    ~idx_ex() { ; }
 
     /// Is it a valid indexing expression?
     operator bool() const { return m_id; }
@@ -58,6 +56,10 @@ class idx_ex {
 
     /// Comparison
     int compare(const idx_ex&, bool strict = true) const;
+    /// Hash value (consistent with comparison)
+    unsigned hash(bool strict = true) const;
+    /// Are index expressions identical (index sets compared by address)?
+    bool identical(const idx_ex&) const;
 
     /// Get index
     unsigned get_id() const { return m_id; }
@@ -80,6 +82,7 @@ class idx_ex {
     friend class internal::ex_idx;
     friend internal::ptr_base internal::add_idx(const internal::ptr_base &e, const idx_ex &ie);
     friend vec_ex expand(const symbolic::ex &e);
+    friend ex expand_idx(const symbolic::ex &e, std::vector<internal::idx_ren> &values);
 
 }; /* class idx_ex */
 
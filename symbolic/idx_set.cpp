@@ -15,12 +15,27 @@
 
 #include <idx_set.h>
 #include <stringhash.h>
+#include <map>
 
 
 using namespace symbolic;
 using namespace symbolic::internal;
 
 
+namespace {
+
+// Implementations in use with their ref counts (see idx_set::drop())
+std::map<idx_set_impl*, int*>&
+impls()
+{
+    // Never destroyed, index sets held by static objects may outlive it
+    static std::map<idx_set_impl*, int*> *instance = new std::map<idx_set_impl*, int*>;
+    return *instance;
+}
+
+} /* namespace */
+
+
 idx_set::idx_set() : m_p(0), m_rc(0)
 {
 }
@@ -28,9 +43,7 @@ idx_set::idx_set() : m_p(0), m_rc(0)
 
 idx_set::idx_set(const string &name)
 {
-    m_rc = new int;
-    *m_rc = 1;
-    m_p = new idx_set_impl(name);
+    init(new idx_set_impl(name));
 }
 
 
@@ -50,14 +63,10 @@ idx_set::idx_set(const idx_set &is)
 idx_set::idx_set(const idx_set &is, const std::string &name)
 {
     if (!is.m_p) {
-        m_rc = new int;
-        *m_rc = 1;
-        m_p = new idx_set_impl(name);
+        init(new idx_set_impl(name));
         return;
     } else if (is.m_p->m_name) {
-        m_rc = new int;
-        *m_rc = 1;
-        m_p = new idx_set_impl(*is.m_p);
+        init(new idx_set_impl(*is.m_p));
     } else {
         m_p = is.m_p;
         m_rc = is.m_rc;
@@ -81,11 +90,22 @@ idx_set::operator=(const idx_set &is)
 }
 
 
+void
+idx_set::init(idx_set_impl *p)
+{
+    m_p = p;
+    m_rc = new int;
+    *m_rc = 1;
+    impls()[m_p] = m_rc;
+}
+
+
 void
 idx_set::dec_rc()
 {
     if (m_rc) {
         if (--(*m_rc) == 0) {
+            impls().erase(m_p);
             delete m_rc;
             delete m_p;
         }
@@ -93,6 +113,18 @@ idx_set::dec_rc()
 }
 
 
+void
+idx_set::drop()
+{
+    std::map<idx_set_impl*, int*> &im = impls();
+    for (std::map<idx_set_impl*, int*>::iterator it = im.begin(); it != im.end(); ++it) {
+        delete it->second;
+        delete it->first;
+    }
+    im.clear();
+}
+
+
 idx_set
 idx_set::prefix(const std::string &s) const
 {
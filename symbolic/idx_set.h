@@ -21,6 +21,7 @@
 #include <idx_set_impl.h>
 #include <string>
 #include <iostream>
+#include <utility>
 
 
 namespace symbolic {
@@ -37,12 +38,17 @@ class idx_set {
     explicit idx_set(const string &name);
     /// Copy constructor.
     idx_set(const idx_set &is);
+    /// Move constructor
+    idx_set(idx_set &&is) noexcept : m_p(is.m_p), m_rc(is.m_rc) { is.m_p = 0; is.m_rc = 0; }
     /// 'Copy constructor' with new name.
     idx_set(const idx_set &is, const std::string &name);
     /// Destructor.
     ~idx_set();
     /// Assignment.
     idx_set& operator=(const idx_set&);
+    /// Move assignment
+    idx_set& operator=(idx_set &&is) noexcept
+        { std::swap(m_p, is.m_p); std::swap(m_rc, is.m_rc); return *this; }
 
     /// Is it a valid index set?
     operator bool() const { return m_p; }
@@ -91,11 +97,17 @@ class idx_set {
     /// LaTeX string representation
     string tex() const { if (m_p) return m_p->tex(); else return "??"; }
 
+    /// Free all index sets in use; called when expression nodes referring
+    /// to them are dropped (see internal::node_pools).
+    static void drop();
+
   private:
     // Pointer to implementation
     internal::idx_set_impl *m_p;
     // Pointer to ref count.
     int *m_rc;
+    // Set implementation (ref count is 1).
+    void init(internal::idx_set_impl *p);
     // Decrease ref count.
     void dec_rc();
 
@@ -108,6 +120,7 @@ class idx_set {
     friend class internal::ex_sum;
     friend class internal::ex_prod;
     friend vec_ex expand(const ex &e);
+    friend ex expand_idx(const ex &e, std::vector<internal::idx_ren> &values);
 
 }; /* class idx_set */
 
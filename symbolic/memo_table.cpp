@@ -0,0 +1,136 @@
+/*****************************************************************************
+ * This file is a part of gEcon.                                             *
+ *                                                                           *
+ * (c) Chancellery of the Prime Minister of the Republic of Poland 2012-2015 *
+ * (c) Grzegorz Klima, Karol Podemski, Kaja Retkiewicz-Wijtiwiak 2015-2016   *
+ * License terms can be found in the file 'LICENCE'                          *
+ *                                                                           *
+ * Author: Grzegorz Klima                                                    *
+ *****************************************************************************/
+
+/** \file memo_table.cpp
+ * \brief Open addressing memo table for operations on expression nodes.
+ */
+
+#include <memo_table.h>
+#include <ex_base.h>
+#include <unique_table.h>
+#include <utils.h>
+
+
+using namespace symbolic::internal;
+
+
+namespace {
+
+const unsigned initial_size = 1024;
+// Max number of entries
+const unsigned max_entries = 1u << 20;
+
+} /* namespace */
+
+
+
+memo_table::memo_table() : m_size(0), m_hits(0), m_misses(0), m_flushes(0)
+{
+    m_tab.resize(initial_size);
+}
+
+
+
+unsigned
+memo_table::hash(const ptr_base &e, unsigned c, const ptr_base &a, int arg)
+{
+    unsigned h = hash_mix(e->hash(), c);
+    if (a.get()) h = hash_mix(h, a->hash());
+    return hash_mix(h, (unsigned) arg);
+}
+
+
+
+const ptr_base*
+memo_table::find(const ptr_base &e, unsigned c, const ptr_base &a, int arg)
+{
+    unsigned h = hash(e, c, a, arg);
+    unsigned mask = m_tab.size() - 1;
+    for (unsigned i = h & mask; m_tab[i].e.get(); i = (i + 1) & mask) {
+        const entry &en = m_tab[i];
+        if ((en.e.get() == e.get()) && (en.c == c) && (en.a.get() == a.get())
+            && (en.arg == arg)) {
+            ++m_hits;
+            return &en.r;
+        }
+    }
+    ++m_misses;
+    return 0;
+}
+
+
+
+void
+memo_table::insert(const ptr_base &e, unsigned c, const ptr_base &a, int arg,
+                   const ptr_base &r)
+{
+    if (m_size >= max_entries) {
+        ++m_flushes;
+        flush();
+    }
+    unsigned h = hash(e, c, a, arg);
+    unsigned mask = m_tab.size() - 1;
+    unsigned i = h & mask;
+    while (m_tab[i].e.get()) i = (i + 1) & mask;
+    entry &en = m_tab[i];
+    en.e = e;
+    en.a = a;
+    en.r = r;
+    en.arg = arg;
+    en.c = c;
+    en.h = h;
+    if (4 * ++m_size > 3 * m_tab.size()) rehash();
+}
+
+
+
+void
+memo_table::clear()
+{
+    flush();
+    m_hits = m_misses = m_flushes = 0;
+}
+
+
+
+std::string
+memo_table::stats() const
+{
+    if (!m_hits && !m_misses) return std::string();
+    return num2str((unsigned) m_hits) + " hits, " + num2str((unsigned) m_misses)
+           + " misses, " + num2str((unsigned) m_flushes) + " flush(es)";
+}
+
+
+
+void
+memo_table::flush()
+{
+    std::vector<entry> tab(initial_size);
+    // Entries are released here, before the table is reused
+    m_tab.swap(tab);
+    m_size = 0;
+}
+
+
+
+void
+memo_table::rehash()
+{
+    std::vector<entry> old(2 * m_tab.size());
+    old.swap(m_tab);
+    unsigned mask = m_tab.size() - 1;
+    for (std::vector<entry>::iterator it = old.begin(); it != old.end(); ++it) {
+        if (!it->e.get()) continue;
+        unsigned i = it->h & mask;
+        while (m_tab[i].e.get()) i = (i + 1) & mask;
+        m_tab[i] = std::move(*it);
+    }
+}
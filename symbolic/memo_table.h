@@ -0,0 +1,82 @@
+/*****************************************************************************
+ * This file is a part of gEcon.                                             *
+ *                                                                           *
+ * (c) Chancellery of the Prime Minister of the Republic of Poland 2012-2015 *
+ * (c) Grzegorz Klima, Karol Podemski, Kaja Retkiewicz-Wijtiwiak 2015-2016   *
+ * License terms can be found in the file 'LICENCE'                          *
+ *                                                                           *
+ * Author: Grzegorz Klima                                                    *
+ *****************************************************************************/
+
+/** \file memo_table.h
+ * \brief Open addressing memo table for operations on expression nodes.
+ */
+
+#ifndef SYMBOLIC_MEMO_TABLE_H
+
+#define SYMBOLIC_MEMO_TABLE_H
+
+#include <decl.h>
+#include <ptr_base.h>
+#include <string>
+#include <vector>
+
+
+namespace symbolic {
+namespace internal {
+
+
+/// Table memoizing results of operations on expression nodes. Nodes are
+/// unique (hash-consed), so entries are keyed by the address of the
+/// node, operation code and argument (a node, e.g. variable of
+/// differentiation, and / or an integer, e.g. lag). Entries hold
+/// references to their nodes, so addresses cannot be reused while
+/// the entry lives. When the table reaches its size bound it is flushed.
+class memo_table
+{
+  public:
+    /// Constructor
+    memo_table();
+
+    /// Result of operation c on e with arguments a (may be null) and arg,
+    /// null if not in the table.
+    const ptr_base* find(const ptr_base &e, unsigned c, const ptr_base &a, int arg);
+    /// Store result of operation (after find() failed; operation may have
+    /// added entries in the meantime).
+    void insert(const ptr_base &e, unsigned c, const ptr_base &a, int arg,
+                const ptr_base &r);
+    /// Drop all entries and reset statistics.
+    void clear();
+    /// Number of entries
+    unsigned size() const { return m_size; }
+    /// Table statistics (empty if table was not used)
+    std::string stats() const;
+
+  private:
+    // Table entry
+    struct entry {
+        entry() : e(0), a(0), r(0), arg(0), c(0), h(0) { ; }
+        ptr_base e, a, r;
+        int arg;
+        unsigned c, h;
+    };
+    // Open addressing table (size is a power of 2)
+    std::vector<entry> m_tab;
+    // Number of entries
+    unsigned m_size;
+    // Statistics
+    unsigned long m_hits, m_misses, m_flushes;
+    // Hash of key
+    static unsigned hash(const ptr_base &e, unsigned c, const ptr_base &a, int arg);
+    // Grow table
+    void rehash();
+    // Drop all entries
+    void flush();
+
+}; /* class memo_table */
+
+
+} /* namespace internal */
+} /* namespace symbolic */
+
+#endif /* SYMBOLIC_MEMO_TABLE_H */
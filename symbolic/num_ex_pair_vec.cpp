@@ -18,6 +18,7 @@
 #include <ex_pow.h>
 #include <ops.h>
 #include <cmp.h>
+#include <unique_table.h>
 #include <cmath>
 #include <climits>
 #include <algorithm>
@@ -47,17 +48,6 @@ num_ex_pair_vec::num_ex_pair_vec(const Number &s, const num_ex_pair_vec &p, ex_t
 }
 
 
-num_ex_pair_vec::num_ex_pair_vec(const num_ex_pair_vec &a,
-                                 const num_ex_pair_vec &b, ex_type t)
-{
-    num_ex_pair_vec_base::const_iterator ia, ib;
-
-    insert(end(), a.begin(), a.end());
-    insert(end(), b.begin(), b.end());
-    reduce(t);
-}
-
-
 int
 num_ex_pair_vec::compare(const num_ex_pair_vec &b) const
 {
@@ -76,6 +66,41 @@ num_ex_pair_vec::compare(const num_ex_pair_vec &b) const
 }
 
 
+unsigned
+num_ex_pair_vec::hash() const
+{
+    unsigned h = size();
+    for (num_ex_pair_vec_base::const_iterator i = begin(); i != end(); ++i) {
+        h = hash_mix(h, hash_num(i->first));
+        h = hash_mix(h, i->second->hash());
+    }
+    return h;
+}
+
+
+unsigned long long
+num_ex_pair_vec::sig() const
+{
+    unsigned long long s = 0;
+    for (num_ex_pair_vec_base::const_iterator i = begin(); i != end(); ++i)
+        s |= i->second->sig();
+    return s;
+}
+
+
+bool
+num_ex_pair_vec::identical(const num_ex_pair_vec &b) const
+{
+    if (size() != b.size()) return false;
+    for (num_ex_pair_vec_base::const_iterator i = begin(), ib = b.begin();
+         i != end(); ++i, ++ib) {
+        if (i->second.get() != ib->second.get()) return false;
+        if (!identical_num(i->first, ib->first)) return false;
+    }
+    return true;
+}
+
+
 namespace {
 
 struct cmp_pair {
@@ -87,38 +112,74 @@ struct cmp_pair {
 } /* namespace */
 
 
+num_ex_pair_vec::num_ex_pair_vec(const num_ex_pair_vec &a,
+                                 const num_ex_pair_vec &b, ex_type t)
+{
+    // Operands of canonical ADD / MUL are sorted but rewriting in reduce()
+    // may leave them out of order; such inputs take the slow path.
+    if (!std::is_sorted(a.begin(), a.end(), cmp_pair())
+        || !std::is_sorted(b.begin(), b.end(), cmp_pair())) {
+        reserve(a.size() + b.size());
+        insert(end(), a.begin(), a.end());
+        insert(end(), b.begin(), b.end());
+        reduce(t);
+        return;
+    }
+
+    // merge, combining like terms
+    reserve(a.size() + b.size());
+    num_ex_pair_vec_base::const_iterator ia = a.begin(), ib = b.begin();
+    while ((ia != a.end()) && (ib != b.end())) {
+        int c = symbolic::internal::compare(ia->second, ib->second);
+        if (c < 0) {
+            push_back(*ia++);
+        } else if (c > 0) {
+            push_back(*ib++);
+        } else {
+            Number s = ia->first + ib->first;
+            if (s != 0.) push_back(num_ex_pair(s, ia->second));
+            ++ia;
+            ++ib;
+        }
+    }
+    insert(end(), ia, a.end());
+    insert(end(), ib, b.end());
+    reduce_sorted(t);
+}
+
+
 void
 num_ex_pair_vec::reduce(ex_type t)
 {
-    // sort
     std::sort(begin(), end(), cmp_pair());
+    reduce_sorted(t);
+}
+
 
-    // reduce numbers
-    num_ex_pair_vec_base::iterator i = begin();
+void
+num_ex_pair_vec::reduce_sorted(ex_type t)
+{
+    if (empty()) return;
+
+    // reduce numbers (they come first)
+    num_ex_pair_vec_base::iterator i = begin(), o;
     if (i->second->type() == NUM) {
         Number x = 0.;
         if (t == MUL) x = 1.;
-        if (i->first != 1.) {
-            if (t == ADD) x = i->first * i->second->val();
-            if (t == MUL) x = pow(i->second->val(), i->first);
-        } else x = i->second->val();
-        ++i;
-        while ((size() > 1) && (i->second->type() == NUM)) {
+        for (; (i != end()) && (i->second->type() == NUM); ++i) {
             if (t == ADD) x += i->first * i->second->val();
             if (t == MUL) x *= pow(i->second->val(), i->first);
-            erase(i);
         }
-        if ((t == ADD) && (x == 0.)) {
-            erase(begin());
-        } else if ((t == MUL) && (x == 0.)) {
+        if ((t == MUL) && (x == 0.)) {
             clear();
             return;
-        } else if ((t == MUL) && (x == 1.)) {
-            erase(begin()); return;
+        }
+        if (((t == ADD) && (x == 0.)) || ((t == MUL) && (x == 1.))) {
+            erase(begin(), i);
         } else {
-            i = begin();
-            i->first = 1.;
-            i->second = ex_num::create(x);
+            begin()->first = 1.;
+            begin()->second = ex_num::create(x);
+            erase(begin() + 1, i);
         }
     }
 
@@ -132,30 +193,32 @@ num_ex_pair_vec::reduce(ex_type t)
                     const ex_mul *pmul = it->second.get<ex_mul>();
                     num_ex_pair_vec newops = pmul->get_ops();
                     newops.erase(newops.begin());
-                    it->second = ex_mul::create(newops);
+                    it->second = ex_mul::create(std::move(newops));
                 }
             }
         }
     }
 
     // collect similar terms
-    for (num_ex_pair_vec_base::iterator ia = begin(), ib = begin() + 1; ib < end();) {
-        int c = symbolic::internal::compare(ia->second, ib->second);
-        if (c) {
-            ++ia;
-            ++ib;
-        } else {
-            ia->first += ib->first;
-            erase(ib);
+    o = begin();
+    for (i = begin(); i != end(); ++i) {
+        if ((o != begin()) && symbolic::internal::equal((o - 1)->second, i->second)) {
+            (o - 1)->first += i->first;
+            continue;
         }
+        if (o != i) *o = std::move(*i);
+        ++o;
     }
+    erase(o, end());
 
     // remove terms with coeff 0
-    for (i = begin(); i != end();) {
-        if (i->first == 0.) {
-            erase(i);
-        } else ++i;
+    o = begin();
+    for (i = begin(); i != end(); ++i) {
+        if (i->first == 0.) continue;
+        if (o != i) *o = std::move(*i);
+        ++o;
     }
+    erase(o, end());
 
     // if mul collect remove powers of Kronecker deltas
     if (t == MUL) {
@@ -167,23 +230,26 @@ num_ex_pair_vec::reduce(ex_type t)
     }
 
     // if mul collect powers with same base
-    if (t == MUL) {
-        if (size() < 2) return;
-        for (num_ex_pair_vec_base::iterator ia = begin(), ib = begin() + 1; ib < end(); ++ib, ++ia) {
-            if ((ia->second->type() == POW) && (ib->second->type() == POW)) {
-                const ex_pow *p1 = ia->second.get<ex_pow>();
-                const ex_pow *p2 = ib->second.get<ex_pow>();
-                if (!symbolic::internal::compare(p1->get_base(), p2->get_base())) {
+    if ((t == MUL) && (size() > 1)) {
+        o = begin();
+        for (i = begin(); i != end(); ++i) {
+            if ((o != begin()) && ((o - 1)->second->type() == POW)
+                && (i->second->type() == POW)) {
+                const ex_pow *p1 = (o - 1)->second.get<ex_pow>();
+                const ex_pow *p2 = i->second.get<ex_pow>();
+                if (symbolic::internal::equal(p1->get_base(), p2->get_base())) {
                     ptr_base tmp = mk_pow(p1->get_base(),
-                                    mk_add(ex_add::create(ia->first, p1->get_exp()),
-                                        ex_add::create(ib->first, p2->get_exp())));
-                    ia->second = tmp;
-                    ia->first = 1.;
-                    --ia;
-                    erase(ib);
+                                    mk_add(ex_add::create((o - 1)->first, p1->get_exp()),
+                                        ex_add::create(i->first, p2->get_exp())));
+                    (o - 1)->second = tmp;
+                    (o - 1)->first = 1.;
+                    continue;
                 }
             }
+            if (o != i) *o = std::move(*i);
+            ++o;
         }
+        erase(o, end());
     }
 
     // if mul that is add reduce to add
@@ -19,7 +19,7 @@
 
 #include <number.h>
 #include <ptr_base.h>
-#include <vector>
+#include <small_vec.h>
 
 
 namespace symbolic {
@@ -27,7 +27,8 @@ namespace internal {
 
 
 typedef std::pair<Number, ptr_base> num_ex_pair;
-typedef std::vector<num_ex_pair> num_ex_pair_vec_base;
+/// Most sums and products have few operands, these are kept inline.
+typedef small_vec<num_ex_pair, 4> num_ex_pair_vec_base;
 
 /// Vector of scalar-expression pairs used in construction
 /// of classes representing addition and multiplication.
@@ -42,16 +43,34 @@ class num_ex_pair_vec : public num_ex_pair_vec_base {
     /// Constructor from scalar and num_ex_pair_vec (scaling).
     num_ex_pair_vec(const Number &s, const num_ex_pair_vec &p, ex_type t);
     /// Constructor from a pair of 2 scalar expression pairs
+    /// (sorted inputs are merged in linear time)
     num_ex_pair_vec(const num_ex_pair_vec &a,
                     const num_ex_pair_vec &b, ex_type t);
+    /// Copy constructor
+    num_ex_pair_vec(const num_ex_pair_vec&) = default;
+    /// Move constructor
+    num_ex_pair_vec(num_ex_pair_vec&&) = default;
     /// Destructor
     ~num_ex_pair_vec() { ; }
 
+    /// Assignment
+    num_ex_pair_vec& operator=(const num_ex_pair_vec&) = default;
+    /// Move assignment
+    num_ex_pair_vec& operator=(num_ex_pair_vec&&) = default;
+
     /// Factor out coefficient
     int compare(const num_ex_pair_vec&) const;
+    /// Hash value
+    unsigned hash() const;
+    /// Signature (union of signatures of expressions)
+    unsigned long long sig() const;
+    /// Are vectors identical (expressions compared by address)?
+    bool identical(const num_ex_pair_vec&) const;
 
     /// Reduce
     void reduce(ex_type t);
+    /// Reduce vector that is already sorted
+    void reduce_sorted(ex_type t);
     /// Max lag in expression
     int get_lag_max(bool stop_on_E = false) const;
     /// Min lag in expression
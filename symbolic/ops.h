@@ -18,6 +18,7 @@
 
 #include <decl.h>
 #include <ptr_base.h>
+#include <vector>
 #include <string>
 
 
@@ -49,6 +50,34 @@ ptr_base mk_E(const ptr_base &p, int l);
 /// Function.
 ptr_base mk_func(func_code c, const ptr_base &arg);
 
+/// Deferred canonicalization. While on, transformations below (lag, ss,
+/// drop_Es, subst, substidx, expandsp) build sums, products, powers,
+/// functions and indexed expressions as raw nodes: operands are neither
+/// merged nor sorted and nodes are not hash-consed. Raw expressions may be
+/// passed to further transformations only; canon() brings them to the
+/// canonical form in one bottom-up pass. Returns the previous state.
+bool set_deferred(bool on);
+/// Canonical form of expression (built with deferred canonicalization).
+ptr_base canon(const ptr_base &p);
+/// Deferred canonicalization on / off while object exists. Node methods
+/// calling transformations set it themselves, their results must be canonical.
+class deferred_canon {
+  public:
+    /// Constructor
+    explicit deferred_canon(bool on = true) : m_prev(set_deferred(on)) { ; }
+    /// Destructor (restores previous state)
+    ~deferred_canon() { set_deferred(m_prev); }
+
+  private:
+    // Previous state
+    bool m_prev;
+
+}; /* class deferred_canon */
+/// Are phases chaining transformations (definitions, lags, steady state,
+/// expansion of indexed expressions) run with deferred canonicalization?
+/// On unless environment variable GECON_DEFERRED_CANON is set to 0.
+bool deferred_phases();
+
 /// Lag expression.
 ptr_base lag(const ptr_base &p, int l);
 /// Set lag of a variable to zero.
@@ -57,11 +86,24 @@ ptr_base lag0(const ptr_base &p);
 ptr_base ss(const ptr_base &p);
 /// Drop expectations
 ptr_base drop_Es(const ptr_base &p);
+/// Algebraic simplification (log(exp(x)) = x, exp(a) * exp(b) = exp(a + b),
+/// etc.), rules requiring a positive argument are applied only if positivity
+/// follows from the form of the expression.
+ptr_base simplify(const ptr_base &p);
 /// Substitution.
 ptr_base subst(const ptr_base &e, const ptr_base &what, const ptr_base &with,
                bool all_leads_lags = true);
+/// List of (what, with) pairs for simultaneous substitution
+typedef std::vector<std::pair<ptr_base, ptr_base> > subst_list;
+/// Simultaneous substitution (single traversal).
+ptr_base subst(const ptr_base &e, const subst_list &sl, bool all_leads_lags = true);
 /// Index substitution.
 ptr_base substidx(const ptr_base &e, unsigned what, int with);
+/// Index substitution (pairs of indices and values in order).
+ptr_base substidx(const ptr_base &e, const idx_ren &iv);
+/// Variable / parameter with fixed indices replaced by free ones (which
+/// cannot clash with user indices); (free index, value) pairs are appended to iv.
+ptr_base free_idx(const ptr_base &p, idx_ren &iv);
 /// Given variable or paramter create new one by appending string to its name
 ptr_base append_name(const ptr_base &p, const std::string &s);
 /// Add indexing to a variable / parameter.
@@ -77,16 +119,33 @@ ptr_base mk_prod(const ptr_base &p);
 
 /// Expand sums and products.
 ptr_base expandsp(const ptr_base &p);
+/// Instances of subtrees (node, instance), see instidx
+typedef std::map<const ex_base*, std::pair<ptr_base, ptr_base> > inst_cache;
+/// Substitute values for indices and expand sums and products, i.e.
+/// expandsp(substidx(...)) in one traversal; sums of Kronecker delta guarded
+/// terms are reduced to a single term. Instances of subtrees without indices
+/// iv[nc], iv[nc + 1], ... are stored in cache (valid while iv[0], ...,
+/// iv[nc - 1] do not change).
+ptr_base instidx(const ptr_base &p, const idx_ren &iv, unsigned nc, inst_cache &cache);
 
 /// Does expression contain conditional expectations?
 bool has_Es(const ptr_base &e);
 /// Find expressions under expected value
 void find_Es(const ptr_base&, set_ex&);
+/// Does expression contain products over indices?
+bool has_prods(const ptr_base &e);
 
 /// Collect variables and parameters.
 void collect(const ptr_base&, set_ex &vars, set_ex &parms);
 /// Collect variables in lag > 1
 void collect_lags(const ptr_base &p, map_ex_int &map);
+/// Collect occurrences of variables and parameters
+void collect_occ(const ptr_base &p, map_ex_int &occ);
+/// Occurrence flag of a lag
+unsigned occ_lag_flag(int l);
+/// Cost of evaluating expression: number of leaves and operations
+/// with common subexpressions counted at each occurrence.
+unsigned cost(const ptr_base &p);
 
 /// Collect indices.
 void collect_idx(const ptr_base &p, std::set<unsigned> &iset);
@@ -94,6 +153,12 @@ void collect_idx(const ptr_base &p, std::set<unsigned> &iset);
 void collect_fidx(const ptr_base &p, std::map<unsigned, unsigned> &im);
 /// Collect free indices.
 void collect_fidx(const idx_ex &ie, std::map<unsigned, unsigned> &im);
+/// Hash value of expression with indices renamed, computed without
+/// building the renamed expression. Operands of additions and
+/// multiplications are combined regardless of their order (renaming may
+/// reorder them), indexed expressions rename their own index to
+/// a placeholder.
+unsigned hash_idx(const ptr_base &p, const idx_ren &ren);
 
 /// Differentiate
 ptr_base mk_diff(const ptr_base &e, const ptr_base &v);
@@ -24,9 +24,14 @@
 #include <cmp.h>
 #include <error.h>
 #include <ops.h>
+#include <diff_cache.h>
+#include <unique_table.h>
 #include <iostream>
 #include <cmath>
 #include <climits>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
 
 
 using namespace symbolic;
@@ -108,6 +113,163 @@ mk_rec_add(const num_ex_pair_vec &ops, unsigned b, unsigned e)
     return mk_add(mk_rec_add(ops, b, b + d), mk_rec_add(ops, b + d + 1, e));
 }
 
+
+// Bulk construction of sums and products. Operands are flattened into
+// like terms grouped in a hash table, coefficients (exponents) are summed
+// in the order in which pairwise construction (mk_rec_add, mk_rec_mul)
+// would sum them and terms are sorted once. The result is identical to
+// pairwise construction. Operands to which other rules of mk_add / mk_mul
+// and num_ex_pair_vec::reduce apply are left to pairwise construction.
+
+// Number of operands from which bulk construction is used
+const unsigned bulk_min_ops = 8;
+
+// Occurrence of a term in operand pos with coefficient (exponent) c
+struct term_occ {
+    unsigned pos;
+    Number c;
+};
+
+// Term with its occurrences (in order of operands)
+struct term_group {
+    ptr_base term;
+    std::vector<term_occ> occ;
+    explicit term_group(const ptr_base &t) : term(t) { ; }
+};
+
+// Like terms of operands
+class term_table {
+  public:
+    // Add occurrence of term
+    void add(unsigned pos, const Number &c, const ptr_base &t)
+    {
+        term_group *g = 0;
+        typedef std::unordered_multimap<unsigned, unsigned>::const_iterator iter;
+        std::pair<iter, iter> r = m_hash.equal_range(t->hash());
+        for (iter it = r.first; it != r.second; ++it) {
+            if (equal(m_groups[it->second].term, t)) {
+                g = &m_groups[it->second];
+                break;
+            }
+        }
+        if (!g) {
+            m_hash.insert(std::make_pair(t->hash(), (unsigned) m_groups.size()));
+            m_groups.push_back(term_group(t));
+            g = &m_groups.back();
+        }
+        term_occ o;
+        o.pos = pos;
+        o.c = c;
+        g->occ.push_back(o);
+    }
+    // Terms with nonzero coefficients summed over n operands, sorted
+    void result(unsigned n, num_ex_pair_vec &out) const;
+
+  private:
+    std::vector<term_group> m_groups;
+    std::unordered_multimap<unsigned, unsigned> m_hash;
+};
+
+// Sum of coefficients in operands b..e as pairwise construction
+// computes it: halves are added and zero sums dropped at each level
+bool
+tree_sum(const term_occ *o, unsigned n, unsigned b, unsigned e, Number &s)
+{
+    if (!n) return false;
+    if (n == 1) {
+        s = o->c;
+        return (s != 0.);
+    }
+    unsigned m = b + (e - b) / 2, k = 0;
+    while ((k < n) && (o[k].pos <= m)) ++k;
+    Number l, r;
+    bool hl = tree_sum(o, k, b, m, l), hr = tree_sum(o + k, n - k, m + 1, e, r);
+    if (hl && hr) {
+        s = l + r;
+        return (s != 0.);
+    }
+    s = (hl) ? l : r;
+    return (hl || hr);
+}
+
+struct cmp_term {
+    bool operator()(const num_ex_pair &a, const num_ex_pair &b) const {
+        return (compare(a.second, b.second) < 0);
+    }
+}; /* struct cmp_term */
+
+void
+term_table::result(unsigned n, num_ex_pair_vec &out) const
+{
+    out.reserve(m_groups.size());
+    for (std::vector<term_group>::const_iterator it = m_groups.begin();
+         it != m_groups.end(); ++it) {
+        Number s;
+        if (tree_sum(&it->occ[0], it->occ.size(), 0, n - 1, s))
+            out.push_back(num_ex_pair(s, it->term));
+    }
+    std::sort(out.begin(), out.end(), cmp_term());
+}
+
+// Can term of sum be added to others without rewriting?
+bool
+plain_add_term(const ptr_base &t)
+{
+    unsigned tt = t->type();
+    if (tt == IDX) return false;
+    if (tt == MUL) return (t.get<ex_mul>()->get_ops()[0].second->type() != NUM);
+    return true;
+}
+
+// Can factor of product be multiplied by others without rewriting?
+bool
+plain_mul_term(const ptr_base &t)
+{
+    unsigned tt = t->type();
+    return (tt != NUM) && (tt != POW) && (tt != DELTA) && (tt != IDX)
+           && (tt != MUL) && !((tt == ADD) && (t->flag() & SINGLE));
+}
+
+ptr_base
+mk_bulk_add(const num_ex_pair_vec &ops)
+{
+    unsigned i, n = ops.size();
+    term_table tt;
+    // Constants are collected as coefficients of 1
+    ptr_base one = ex_num::one();
+    for (i = 0; i < n; ++i) {
+        ptr_base p = mk_mul(ex_num::create(ops[i].first), ops[i].second);
+        unsigned t = p->type();
+        if (t == NUM) {
+            tt.add(i, p->val(), one);
+        } else if (t == ADD) {
+            const num_ex_pair_vec &in = p.get<ex_add>()->get_ops();
+            num_ex_pair_vec_base::const_iterator it;
+            for (it = in.begin(); it != in.end(); ++it) {
+                if ((it != in.begin()) && (compare((it - 1)->second, it->second) >= 0))
+                    return mk_rec_add(ops, 0, n - 1);
+                if (it->second->type() == NUM) {
+                    tt.add(i, it->first * it->second->val(), one);
+                } else {
+                    if (!plain_add_term(it->second)) return mk_rec_add(ops, 0, n - 1);
+                    tt.add(i, it->first, it->second);
+                }
+            }
+        } else {
+            if (!plain_add_term(p)) return mk_rec_add(ops, 0, n - 1);
+            tt.add(i, 1., p);
+        }
+    }
+    num_ex_pair_vec out;
+    tt.result(n, out);
+    // The constant (numbers come first) is a term of its own
+    if (out.size() && (out[0].second.get() == one.get())) {
+        out[0].second = ex_num::create(out[0].first);
+        out[0].first = 1.;
+    }
+    return reduce(unique_table::get_instance().intern(new ex_add(std::move(out))));
+}
+
 } /* namespace */
 
 
@@ -115,6 +277,7 @@ ptr_base
 symbolic::internal::mk_add(const num_ex_pair_vec &ops)
 {
     if (!ops.size()) return ex_num::zero();
+    if (ops.size() >= bulk_min_ops) return mk_bulk_add(ops);
     return mk_rec_add(ops, 0, ops.size() - 1);
 }
 
@@ -226,6 +389,34 @@ mk_rec_mul(const num_ex_pair_vec &ops, unsigned b, unsigned e)
 }
 
 
+ptr_base
+mk_bulk_mul(const num_ex_pair_vec &ops)
+{
+    unsigned i, n = ops.size();
+    term_table tt;
+    for (i = 0; i < n; ++i) {
+        ptr_base p = mk_pow(ops[i].second, ex_num::create(ops[i].first));
+        if (p->is1()) continue;
+        if (p->type() == MUL) {
+            const num_ex_pair_vec &in = p.get<ex_mul>()->get_ops();
+            num_ex_pair_vec_base::const_iterator it;
+            for (it = in.begin(); it != in.end(); ++it) {
+                if ((it != in.begin()) && (compare((it - 1)->second, it->second) >= 0))
+                    return mk_rec_mul(ops, 0, n - 1);
+                if (!plain_mul_term(it->second)) return mk_rec_mul(ops, 0, n - 1);
+                tt.add(i, it->first, it->second);
+            }
+        } else {
+            if (!plain_mul_term(p)) return mk_rec_mul(ops, 0, n - 1);
+            tt.add(i, 1., p);
+        }
+    }
+    num_ex_pair_vec out;
+    tt.result(n, out);
+    return reduce(unique_table::get_instance().intern(new ex_mul(std::move(out))));
+}
+
+
 } /* namespace */
 
 
@@ -233,6 +424,7 @@ ptr_base
 symbolic::internal::mk_mul(const num_ex_pair_vec &ops)
 {
     if (!ops.size()) return ex_num::one();
+    if (ops.size() >= bulk_min_ops) return mk_bulk_mul(ops);
     return mk_rec_mul(ops, 0, ops.size() - 1);
 }
 
@@ -453,7 +645,7 @@ symbolic::internal::mk_diff(const ptr_base &e, const ptr_base &v)
     }
 
     if (!e->has(v, EXACT_T, false)) return ex_num::zero();
-    return e->diff(v);
+    return cached_diff(e, v);
 }
 
 
@@ -25,7 +25,10 @@
 #include <ex_func.h>
 #include <ex_e.h>
 #include <ex_sum.h>
+#include <ex_prod.h>
+#include <ex_idx.h>
 #include <cmp.h>
+#include <unique_table.h>
 #include <error.h>
 #include <ops.h>
 #include <iostream>
@@ -80,6 +83,47 @@ symbolic::internal::has_Es(const ptr_base &p)
 
 
 
+bool
+symbolic::internal::has_prods(const ptr_base &p)
+{
+    unsigned t = p->type();
+    if ((t == NUM) || (t == DELTA) || (t == SYMB) || (t == SYMBIDX)
+        || (t == VART) || (t == VARTIDX)) {
+        return false;
+    } else if (t == PROD) {
+        return true;
+    } else if (t == ADD) {
+        unsigned i, n = p.get<ex_add>()->no_ops();
+        for (i = 0; i < n; ++i) {
+            if (has_prods(p.get<ex_add>()->get_ops()[i].second))
+                return true;
+        }
+        return false;
+    } else if (t == MUL) {
+        unsigned i, n = p.get<ex_mul>()->no_ops();
+        for (i = 0; i < n; ++i) {
+            if (has_prods(p.get<ex_mul>()->get_ops()[i].second))
+                return true;
+        }
+        return false;
+    } else if (t == POW) {
+        const ex_pow *pt = p.get<ex_pow>();
+        if (has_prods(pt->get_base())) return true;
+        if (has_prods(pt->get_exp())) return true;
+        return false;
+    } else if (t == FUN) {
+        return has_prods(p.get<ex_func>()->get_arg());
+    } else if (t == EX) {
+        return has_prods(p.get<ex_e>()->get_arg());
+    } else if (t == SUM) {
+        return has_prods(p.get<ex_sum>()->get_e());
+    } else if (t == IDX) {
+        return has_prods(p.get<ex_idx>()->get_e());
+    } else INTERNAL_ERROR
+}
+
+
+
 void
 symbolic::internal::find_Es(const ptr_base &p, set_ex &sex)
 {
@@ -342,6 +386,153 @@ symbolic::internal::collect_lags(const ptr_base &p, map_ex_int &map)
 
 
 
+unsigned
+symbolic::internal::occ_lag_flag(int l)
+{
+    if (l == -1) return OCC_LAG_M1;
+    if (l == 0) return OCC_LAG_0;
+    if (l == 1) return OCC_LAG_P1;
+    if (l == INT_MIN) return OCC_LAG_SS;
+    return OCC_LAG_OTH;
+}
+
+
+namespace {
+
+inline
+void
+add_occ(map_ex_int &occ, const ex &e, int l)
+{
+    occ[e] |= occ_lag_flag(l);
+}
+
+} /* namespace */
+
+
+void
+symbolic::internal::collect_occ(const ptr_base &p, map_ex_int &occ)
+{
+    unsigned t = p->type();
+    if ((t == NUM) || (t == DELTA)) {
+        return;
+    } else if ((t == SYMB) || (t == SYMBIDX)) {
+        add_occ(occ, ex(p), 0);
+        return;
+    } else if (t == VART) {
+        const ex_vart *pt = p.get<ex_vart>();
+        add_occ(occ, ex(pt->copy0()), pt->get_lag());
+        return;
+    } else if (t == VARTIDX) {
+        const ex_vartidx *pt = p.get<ex_vartidx>();
+        add_occ(occ, ex(pt->copy0()), pt->get_lag());
+        return;
+    } else if (t == EX) {
+        collect_occ(p.get<ex_e>()->get_arg(), occ);
+        return;
+    } else if (t == ADD) {
+        const num_ex_pair_vec &args = p.get<ex_add>()->get_ops();
+        unsigned i, n = args.size();
+        for (i = 0; i < n; ++i) {
+            collect_occ(args[i].second, occ);
+        }
+        return;
+    } else if (t == MUL) {
+        const num_ex_pair_vec &args = p.get<ex_mul>()->get_ops();
+        unsigned i, n = args.size();
+        for (i = 0; i < n; ++i) {
+            collect_occ(args[i].second, occ);
+        }
+        return;
+    } else if (t == POW) {
+        const ex_pow *pp = p.get<ex_pow>();
+        collect_occ(pp->get_base(), occ);
+        collect_occ(pp->get_exp(), occ);
+        return;
+    } else if (t == FUN) {
+        collect_occ(p.get<ex_func>()->get_arg(), occ);
+        return;
+    } else if (t == SUM) {
+        collect_occ(p.get<ex_sum>()->get_e(), occ);
+        return;
+    } else if (t == PROD) {
+        collect_occ(p.get<ex_prod>()->get_e(), occ);
+        return;
+    } else if (t == IDX) {
+        collect_occ(p.get<ex_idx>()->get_e(), occ);
+        return;
+    } else INTERNAL_ERROR
+}
+
+
+
+namespace {
+
+// Costs of subexpressions already visited
+typedef std::map<const ex_base*, unsigned> cost_map;
+
+// Saturating addition
+inline
+unsigned
+cost_add(unsigned a, unsigned b)
+{
+    return (a > UINT_MAX - b) ? UINT_MAX : a + b;
+}
+
+unsigned
+cost_memo(const ptr_base &p, cost_map &cm)
+{
+    unsigned t = p->type();
+    if ((t == NUM) || (t == DELTA) || (t == SYMB) || (t == SYMBIDX)
+        || (t == VART) || (t == VARTIDX)) {
+        return 1;
+    }
+    cost_map::const_iterator it = cm.find(p.get());
+    if (it != cm.end()) return it->second;
+    unsigned c = 0;
+    if (t == EX) {
+        c = cost_memo(p.get<ex_e>()->get_arg(), cm);
+    } else if ((t == ADD) || (t == MUL)) {
+        // n - 1 operations plus scaling / raising to power for
+        // coefficients other than 1
+        const num_ex_pair_vec &args = (t == ADD) ? p.get<ex_add>()->get_ops()
+                                                 : p.get<ex_mul>()->get_ops();
+        unsigned i, n = args.size();
+        for (i = 0; i < n; ++i) {
+            c = cost_add(c, cost_memo(args[i].second, cm));
+            if (!(args[i].first == 1.)) c = cost_add(c, 1);
+        }
+        c = cost_add(c, n - 1);
+    } else if (t == POW) {
+        const ex_pow *pp = p.get<ex_pow>();
+        c = cost_add(cost_memo(pp->get_base(), cm), cost_memo(pp->get_exp(), cm));
+        c = cost_add(c, 1);
+    } else if (t == FUN) {
+        c = cost_add(cost_memo(p.get<ex_func>()->get_arg(), cm), 1);
+    } else if (t == SUM) {
+        c = cost_add(cost_memo(p.get<ex_sum>()->get_e(), cm), 1);
+    } else if (t == PROD) {
+        c = cost_add(cost_memo(p.get<ex_prod>()->get_e(), cm), 1);
+    } else if (t == IDX) {
+        c = cost_add(cost_memo(p.get<ex_idx>()->get_e(), cm), 1);
+    } else INTERNAL_ERROR
+    cm[p.get()] = c;
+    return c;
+}
+
+} /* namespace */
+
+
+unsigned
+symbolic::internal::cost(const ptr_base &p)
+{
+    cost_map cm;
+    return cost_memo(p, cm);
+}
+
+
+
+
+
 void
 symbolic::internal::collect_idx(const ptr_base &p, std::set<unsigned> &iset)
 {
@@ -452,9 +643,10 @@ symbolic::internal::collect_fidx(const ptr_base &p, std::map<unsigned, unsigned>
         unsigned i, n = args.size();
         for (i = 0; i < n; ++i) {
             collect_fidx(args[i].second, im);
-            for (it = im.begin(); it != im.end(); ++it) {
+            for (it = im.begin(); it != im.end(); ) {
                 if ((it->second == 0) && (imcpy.find(it->first) == imcpy.end()))
-                    im.erase(it);
+                    im.erase(it++);
+                else ++it;
             }
         }
         return;
@@ -465,9 +657,10 @@ symbolic::internal::collect_fidx(const ptr_base &p, std::map<unsigned, unsigned>
         unsigned i, n = args.size();
         for (i = 0; i < n; ++i) {
             collect_fidx(args[i].second, im);
-            for (it = im.begin(); it != im.end(); ++it) {
+            for (it = im.begin(); it != im.end(); ) {
                 if ((it->second == 0) && (imcpy.find(it->first) == imcpy.end()))
-                    im.erase(it);
+                    im.erase(it++);
+                else ++it;
             }
         }
         return;
@@ -475,14 +668,16 @@ symbolic::internal::collect_fidx(const ptr_base &p, std::map<unsigned, unsigned>
         std::map<unsigned, unsigned> imcpy = im;
         std::map<unsigned, unsigned>::iterator it;
         collect_fidx(p.get<ex_pow>()->get_base(), im);
-        for (it = im.begin(); it != im.end(); ++it) {
+        for (it = im.begin(); it != im.end(); ) {
             if ((it->second == 0) && (imcpy.find(it->first) == imcpy.end()))
-                im.erase(it);
+                im.erase(it++);
+            else ++it;
         }
         collect_fidx(p.get<ex_pow>()->get_exp(), im);
-        for (it = im.begin(); it != im.end(); ++it) {
+        for (it = im.begin(); it != im.end(); ) {
             if ((it->second == 0) && (imcpy.find(it->first) == imcpy.end()))
-                im.erase(it);
+                im.erase(it++);
+            else ++it;
         }
         return;
     } else if (t == FUN) {
@@ -517,6 +712,102 @@ symbolic::internal::collect_fidx(const idx_ex &ie, std::map<unsigned, unsigned>
 
 
 
+namespace {
+
+// Index after renaming
+int
+ren_idx(int i, const idx_ren &ren)
+{
+    for (idx_ren::const_reverse_iterator it = ren.rbegin(); it != ren.rend(); ++it) {
+        if ((int) it->first == i) return it->second;
+    }
+    return i;
+}
+
+// Does expression have any of the renamed indices?
+bool
+has_ren(const ptr_base &p, const idx_ren &ren)
+{
+    if (!(p->flag() & HASIDX)) return false;
+    for (idx_ren::const_iterator it = ren.begin(); it != ren.end(); ++it) {
+        if (p->hasidx(it->first)) return true;
+    }
+    return false;
+}
+
+// Hash value of indexing expression with renamed exclusion
+unsigned
+hash_ie(const idx_ex &ie, const idx_ren &ren, bool strict)
+{
+    unsigned x = ie.get_excl_id();
+    if (x) return ie.substidx(x, ren_idx(x, ren)).hash(strict);
+    return ie.hash(strict);
+}
+
+} /* namespace */
+
+
+unsigned
+symbolic::internal::hash_idx(const ptr_base &p, const idx_ren &ren)
+{
+    if (!has_ren(p, ren)) return p->hash();
+    unsigned t = p->type();
+    if (t == DELTA) {
+        const ex_delta *pt = p.get<ex_delta>();
+        int i1 = ren_idx(pt->m_idx1, ren), i2 = ren_idx(pt->m_idx2, ren);
+        if (i1 > i2) std::swap(i1, i2);
+        return hash_mix(hash_mix(DELTA, (unsigned) i1), (unsigned) i2);
+    } else if (t == SYMBIDX) {
+        const ex_symbidx *pt = p.get<ex_symbidx>();
+        unsigned h = hash_mix(SYMBIDX, pt->m_name);
+        h = hash_mix(h, pt->m_noid);
+        h = hash_mix(h, (unsigned) ren_idx(pt->m_idx1, ren));
+        h = hash_mix(h, (unsigned) ren_idx(pt->m_idx2, ren));
+        h = hash_mix(h, (unsigned) ren_idx(pt->m_idx3, ren));
+        return hash_mix(h, (unsigned) ren_idx(pt->m_idx4, ren));
+    } else if (t == VARTIDX) {
+        const ex_vartidx *pt = p.get<ex_vartidx>();
+        unsigned h = hash_mix(hash_mix(VARTIDX, pt->m_name), (unsigned) pt->m_lag);
+        h = hash_mix(h, pt->m_noid);
+        h = hash_mix(h, (unsigned) ren_idx(pt->m_idx1, ren));
+        h = hash_mix(h, (unsigned) ren_idx(pt->m_idx2, ren));
+        h = hash_mix(h, (unsigned) ren_idx(pt->m_idx3, ren));
+        return hash_mix(h, (unsigned) ren_idx(pt->m_idx4, ren));
+    } else if ((t == ADD) || (t == MUL)) {
+        const num_ex_pair_vec &args = (t == ADD) ? p.get<ex_add>()->get_ops()
+                                                 : p.get<ex_mul>()->get_ops();
+        unsigned i, n = args.size(), h = 0;
+        for (i = 0; i < n; ++i)
+            h += hash_mix(hash_num(args[i].first), hash_idx(args[i].second, ren));
+        return hash_mix(t, h);
+    } else if (t == POW) {
+        const ex_pow *pt = p.get<ex_pow>();
+        return hash_mix(hash_mix(POW, hash_idx(pt->get_base(), ren)),
+                        hash_idx(pt->get_exp(), ren));
+    } else if (t == FUN) {
+        const ex_func *pt = p.get<ex_func>();
+        return hash_mix(hash_mix(FUN, (unsigned) pt->get_code()), hash_idx(pt->get_arg(), ren));
+    } else if (t == EX) {
+        const ex_e *pt = p.get<ex_e>();
+        return hash_mix(hash_mix(EX, (unsigned) pt->get_lag()), hash_idx(pt->get_arg(), ren));
+    } else if ((t == SUM) || (t == PROD)) {
+        const idx_ex &ie = (t == SUM) ? p.get<ex_sum>()->get_ie() : p.get<ex_prod>()->get_ie();
+        const ptr_base &e = (t == SUM) ? p.get<ex_sum>()->get_e() : p.get<ex_prod>()->get_e();
+        // index of the sum / product is not renamed inside
+        idx_ren r(ren);
+        r.push_back(std::pair<unsigned, int>(ie.get_id(), ie.get_id()));
+        return hash_mix(hash_mix(t, hash_ie(ie, ren, true)), hash_idx(e, r));
+    } else if (t == IDX) {
+        const ex_idx *pt = p.get<ex_idx>();
+        // index is renamed to a placeholder distinct for each level
+        idx_ren r(ren);
+        r.push_back(std::pair<unsigned, int>(pt->get_ie().get_id(), INT_MIN + 1 + (int) ren.size()));
+        return hash_mix(hash_mix(IDX, hash_ie(pt->get_ie(), ren, false)), hash_idx(pt->get_e(), r));
+    } else INTERNAL_ERROR
+}
+
+
+
 
 
 
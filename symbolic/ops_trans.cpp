@@ -23,28 +23,157 @@
 #include <ex_e.h>
 #include <ex_sum.h>
 #include <cmp.h>
+#include <trans_cache.h>
 #include <error.h>
 #include <ops.h>
 #include <iostream>
 #include <cmath>
 #include <climits>
+#include <cstdlib>
+#include <cstring>
 
 
 using namespace symbolic;
 using namespace symbolic::internal;
 
 
+namespace {
+
+// Deferred canonicalization on?
+bool deferred = false;
+
+// Builders used by transformations (p is the node rebuilt), raw nodes are
+// built in deferred mode. Expected values, sums and products are always
+// canonical, as their constructors restructure arguments and subst matches
+// expected values. Raw nodes are not searched before they are rebuilt (see
+// subst), unchanged ones are returned as they are.
+
+bool
+same_ops(const num_ex_pair_vec &a, const num_ex_pair_vec &b)
+{
+    for (unsigned i = 0, n = a.size(); i < n; ++i) {
+        if ((a[i].second.get() != b[i].second.get()) || (a[i].first != b[i].first))
+            return false;
+    }
+    return true;
+}
 
 
 ptr_base
-symbolic::internal::lag(const ptr_base &p, int l)
+bld_add(const ptr_base &p, num_ex_pair_vec &ops)
 {
-    if (!l) return p;
-    if (!(p->flag() & HAST)) return p;
+    if (!deferred) return mk_add(ops);
+    if ((p->flag() & RAW) && same_ops(p.get<ex_add>()->get_ops(), ops)) return p;
+    return ex_add::create_raw(std::move(ops));
+}
+
+
+ptr_base
+bld_mul(const ptr_base &p, num_ex_pair_vec &ops)
+{
+    if (!deferred) return mk_mul(ops);
+    if ((p->flag() & RAW) && same_ops(p.get<ex_mul>()->get_ops(), ops)) return p;
+    return ex_mul::create_raw(std::move(ops));
+}
+
+
+ptr_base
+bld_pow(const ptr_base &p, const ptr_base &b, const ptr_base &e)
+{
+    if (!deferred) return mk_pow(b, e);
+    const ex_pow *pt = p.get<ex_pow>();
+    if ((p->flag() & RAW) && (pt->get_base().get() == b.get())
+        && (pt->get_exp().get() == e.get())) return p;
+    return ex_pow::create_raw(b, e);
+}
+
+
+ptr_base
+bld_func(const ptr_base &p, func_code c, const ptr_base &arg)
+{
+    if (!deferred) return mk_func(c, arg);
+    if ((p->flag() & RAW) && (p.get<ex_func>()->get_arg().get() == arg.get())) return p;
+    return ex_func::create_raw(c, arg);
+}
+
+
+ptr_base
+bld_idx(const ptr_base &p, const idx_ex &ie, const ptr_base &e)
+{
+    if (!deferred) return ex_idx::create(ie, e);
+    const ex_idx *pt = p.get<ex_idx>();
+    if ((p->flag() & RAW) && (pt->get_e().get() == e.get())
+        && pt->get_ie().identical(ie)) return p;
+    return ex_idx::create_raw(ie, e);
+}
+
+// Transformation through trans_cache. Results of deferred mode are raw
+// and must not be returned later to eager callers, so the cache is bypassed.
+ptr_base
+cached(const ptr_base &p, trans_code c, int arg, trans_fn f)
+{
+    if (deferred) return f(p, arg);
+    return trans_cache::get_instance().get(p, c, arg, f);
+}
+
+} /* namespace */
+
+
+bool
+symbolic::internal::set_deferred(bool on)
+{
+    bool prev = deferred;
+    deferred = on;
+    return prev;
+}
+
+
+bool
+symbolic::internal::deferred_phases()
+{
+    static const char *s = getenv("GECON_DEFERRED_CANON");
+    static bool on = !s || strcmp(s, "0");
+    return on;
+}
+
+
+ptr_base
+symbolic::internal::canon(const ptr_base &p)
+{
+    if (!(p->flag() & RAW)) return p;
     unsigned t = p->type();
-    if (t == VART) return p.get<ex_vart>()->lag(l);
-    else if (t == VARTIDX) return p.get<ex_vartidx>()->lag(l);
-    else if (t == EX) return p.get<ex_e>()->lag(l);
+    if ((t == ADD) || (t == MUL)) {
+        const num_ex_pair_vec &in = (t == ADD) ? p.get<ex_add>()->get_ops()
+                                               : p.get<ex_mul>()->get_ops();
+        num_ex_pair_vec out;
+        unsigned i, n = in.size();
+        out.reserve(n);
+        for (i = 0; i < n; ++i)
+            out.push_back(std::pair<Number, ptr_base>(in[i].first, canon(in[i].second)));
+        return (t == ADD) ? mk_add(out) : mk_mul(out);
+    } else if (t == POW) {
+        const ex_pow *pt = p.get<ex_pow>();
+        return mk_pow(canon(pt->get_base()), canon(pt->get_exp()));
+    } else if (t == FUN) {
+        const ex_func *pt = p.get<ex_func>();
+        return mk_func(pt->get_code(), canon(pt->get_arg()));
+    } else if (t == IDX) {
+        const ex_idx *pt = p.get<ex_idx>();
+        return ex_idx::create(pt->get_ie(), canon(pt->get_e()));
+    } else INTERNAL_ERROR
+}
+
+
+
+
+namespace {
+
+// Lag of compound expression, subexpressions are lagged through the cache
+ptr_base
+lag_node(const ptr_base &p, int l)
+{
+    unsigned t = p->type();
+    if (t == EX) return p.get<ex_e>()->lag(l);
     else if (t == ADD) {
         const num_ex_pair_vec &in = p.get<ex_add>()->get_ops();
         num_ex_pair_vec out;
@@ -53,7 +182,7 @@ symbolic::internal::lag(const ptr_base &p, int l)
         for (i = 0; i < n; ++i)
             out.push_back(std::pair<Number, ptr_base>(in[i].first,
                                                         lag(in[i].second, l)));
-        return mk_add(out);
+        return bld_add(p, out);
     } else if (t == MUL) {
         const num_ex_pair_vec &in = p.get<ex_mul>()->get_ops();
         num_ex_pair_vec out;
@@ -62,55 +191,80 @@ symbolic::internal::lag(const ptr_base &p, int l)
         for (i = 0; i < n; ++i)
             out.push_back(std::pair<Number, ptr_base>(in[i].first,
                                                         lag(in[i].second, l)));
-        return mk_mul(out);
+        return bld_mul(p, out);
     } else if (t == POW) {
         const ex_pow *pt = p.get<ex_pow>();
-        return mk_pow(lag(pt->get_base(), l), lag(pt->get_exp(), l));
+        return bld_pow(p, lag(pt->get_base(), l), lag(pt->get_exp(), l));
     } else if (t == FUN) {
         const ex_func *pt = p.get<ex_func>();
-        return mk_func(pt->get_code(), lag(pt->get_arg(), l));
+        return bld_func(p, pt->get_code(), lag(pt->get_arg(), l));
     } else if (t == IDX) {
         const ex_idx *pt = p.get<ex_idx>();
-        return ex_idx::create(pt->get_ie(), lag(pt->get_e(), l));
+        return bld_idx(p, pt->get_ie(), lag(pt->get_e(), l));
     } else if (t == SUM) {
         const ex_sum *pt = p.get<ex_sum>();
-        return ex_sum::create(pt->get_ie(), lag(pt->get_e(), l));
+        return ex_sum::create(pt->get_ie(), canon(lag(pt->get_e(), l)));
     } else if (t == PROD) {
         const ex_prod *pt = p.get<ex_prod>();
-        return ex_prod::create(pt->get_ie(), lag(pt->get_e(), l));
+        return ex_prod::create(pt->get_ie(), canon(lag(pt->get_e(), l)));
     } else INTERNAL_ERROR
 }
 
+} /* namespace */
 
 
+ptr_base
+symbolic::internal::lag(const ptr_base &p, int l)
+{
+    if (!l) return p;
+    if (!(p->flag() & HAST)) return p;
+    unsigned t = p->type();
+    if (t == VART) return p.get<ex_vart>()->lag(l);
+    else if (t == VARTIDX) return p.get<ex_vartidx>()->lag(l);
+    return cached(p, TRANS_LAG, l, lag_node);
+}
+
+
+
+
+namespace {
+
+// Zero lag of indexed variable
+ptr_base
+lag0_node(const ptr_base &p, int)
+{
+    const ex_idx *pt = p.get<ex_idx>();
+    return ex_idx::create(pt->get_ie(), lag0(pt->get_e()));
+}
+
+} /* namespace */
+
 
 ptr_base
 symbolic::internal::lag0(const ptr_base &p)
 {
     unsigned t = p->type();
-    if (t == VART) return ex_vart::create(p.get<ex_vart>()->m_hash, 0);
+    if (t == VART) return ex_vart::create(p.get<ex_vart>()->m_name, 0);
     else if (t == VARTIDX) {
         const ex_vartidx *pt = p.get<ex_vartidx>();
-        return ex_vartidx::create(pt->m_hash, 0, pt->m_noid, pt->m_idx1,
+        return ex_vartidx::create(pt->m_name, 0, pt->m_noid, pt->m_idx1,
                                   pt->m_idx2, pt->m_idx3, pt->m_idx4);
     } else if (t == IDX) {
-        const ex_idx *pt = p.get<ex_idx>();
-        return ex_idx::create(pt->get_ie(), lag0(pt->get_e()));
+        return cached(p, TRANS_LAG0, 0, lag0_node);
     } else USER_ERROR("lag0 admits variables only")
 }
 
 
 
+namespace {
+
+// Steady state of compound expression, subexpressions are transformed
+// through the cache
 ptr_base
-symbolic::internal::ss(const ptr_base &p)
+ss_node(const ptr_base &p, int)
 {
-    if (!(p->flag() & HAST)) return p;
     unsigned t = p->type();
-    if (t == VART)
-        return p.get<ex_vart>()->lag(INT_MIN);
-    else if (t == VARTIDX) {
-        return p.get<ex_vartidx>()->lag(INT_MIN);
-    } else if (t == EX) return ss(p.get<ex_e>()->get_arg());
+    if (t == EX) return ss(p.get<ex_e>()->get_arg());
     else if (t == ADD) {
         const num_ex_pair_vec &in = p.get<ex_add>()->get_ops();
         num_ex_pair_vec out;
@@ -118,7 +272,7 @@ symbolic::internal::ss(const ptr_base &p)
         out.reserve(n);
         for (i = 0; i < n; ++i)
             out.push_back(num_ex_pair(in[i].first, ss(in[i].second)));
-        return mk_add(out);
+        return bld_add(p, out);
     } else if (t == MUL) {
         const num_ex_pair_vec &in = p.get<ex_mul>()->get_ops();
         num_ex_pair_vec out;
@@ -126,34 +280,54 @@ symbolic::internal::ss(const ptr_base &p)
         out.reserve(n);
         for (i = 0; i < n; ++i)
             out.push_back(std::pair<Number, ptr_base>(in[i].first, ss(in[i].second)));
-        return mk_mul(out);
+        return bld_mul(p, out);
     } else if (t == POW) {
         const ex_pow *pt = p.get<ex_pow>();
-        return mk_pow(ss(pt->get_base()), ss(pt->get_exp()));
+        return bld_pow(p, ss(pt->get_base()), ss(pt->get_exp()));
     } else if (t == FUN) {
         const ex_func *pt = p.get<ex_func>();
-        return mk_func(pt->get_code(), ss(pt->get_arg()));
+        return bld_func(p, pt->get_code(), ss(pt->get_arg()));
     } else if (t == IDX) {
         const ex_idx *pt = p.get<ex_idx>();
-        return ex_idx::create(pt->get_ie(), ss(pt->get_e()));
+        return bld_idx(p, pt->get_ie(), ss(pt->get_e()));
     } else if (t == SUM) {
         const ex_sum *pt = p.get<ex_sum>();
-        return ex_sum::create(pt->get_ie(), ss(pt->get_e()));
+        return ex_sum::create(pt->get_ie(), canon(ss(pt->get_e())));
     } else if (t == PROD) {
         const ex_prod *pt = p.get<ex_prod>();
-        return ex_prod::create(pt->get_ie(), ss(pt->get_e()));
+        return ex_prod::create(pt->get_ie(), canon(ss(pt->get_e())));
     } else INTERNAL_ERROR;
 }
 
+} /* namespace */
+
+
+ptr_base
+symbolic::internal::ss(const ptr_base &p)
+{
+    if (!(p->flag() & HAST)) return p;
+    unsigned t = p->type();
+    if (t == VART)
+        return p.get<ex_vart>()->lag(INT_MIN);
+    else if (t == VARTIDX) {
+        return p.get<ex_vartidx>()->lag(INT_MIN);
+    }
+    return cached(p, TRANS_SS, 0, ss_node);
+}
+
 
 
 
 
 
+namespace {
+
+// Drop expectations in compound expression, subexpressions are transformed
+// through the cache
 ptr_base
-symbolic::internal::drop_Es(const ptr_base &p)
+drop_Es_node(const ptr_base &p, int)
 {
-    if (!has_Es(p)) return p;
+    if (!(p->flag() & RAW) && !has_Es(p)) return p;
     unsigned t = p->type();
     if (t == EX) {
         return p.get<ex_e>()->get_arg();
@@ -165,7 +339,7 @@ symbolic::internal::drop_Es(const ptr_base &p)
         for (i = 0; i < n; ++i)
             out.push_back(std::pair<Number, ptr_base>(in[i].first,
                                                       drop_Es(in[i].second)));
-        return mk_add(out);
+        return bld_add(p, out);
     } else if (t == MUL) {
         const num_ex_pair_vec &in = p.get<ex_mul>()->get_ops();
         num_ex_pair_vec out;
@@ -174,25 +348,36 @@ symbolic::internal::drop_Es(const ptr_base &p)
         for (i = 0; i < n; ++i)
             out.push_back(std::pair<Number, ptr_base>(in[i].first,
                                                       drop_Es(in[i].second)));
-        return mk_mul(out);
+        return bld_mul(p, out);
     } else if (t == POW) {
         const ex_pow *pt = p.get<ex_pow>();
-        return mk_pow(drop_Es(pt->get_base()), drop_Es(pt->get_exp()));
+        return bld_pow(p, drop_Es(pt->get_base()), drop_Es(pt->get_exp()));
     } else if (t == FUN) {
         const ex_func *pt = p.get<ex_func>();
-        return mk_func(pt->get_code(), drop_Es(pt->get_arg()));
+        return bld_func(p, pt->get_code(), drop_Es(pt->get_arg()));
     } else if (t == IDX) {
         const ex_idx *pt = p.get<ex_idx>();
-        return ex_idx::create(pt->get_ie(), drop_Es(pt->get_e()));
+        return bld_idx(p, pt->get_ie(), drop_Es(pt->get_e()));
     } else if (t == SUM) {
         const ex_sum *pt = p.get<ex_sum>();
-        return ex_sum::create(pt->get_ie(), drop_Es(pt->get_e()));
+        return ex_sum::create(pt->get_ie(), canon(drop_Es(pt->get_e())));
     } else if (t == PROD) {
         const ex_prod *pt = p.get<ex_prod>();
-        return ex_prod::create(pt->get_ie(), drop_Es(pt->get_e()));
+        return ex_prod::create(pt->get_ie(), canon(drop_Es(pt->get_e())));
     } else INTERNAL_ERROR;
 }
 
+} /* namespace */
+
+
+ptr_base
+symbolic::internal::drop_Es(const ptr_base &p)
+{
+    // Atomic expressions have no expectations
+    if (p->type() < FUN) return p;
+    return cached(p, TRANS_DROP_ES, 0, drop_Es_node);
+}
+
 
 
 ptr_base
@@ -203,16 +388,16 @@ symbolic::internal::append_name(const ptr_base &p, const std::string &s)
         const ex_idx *pt = p.get<ex_idx>();
         return ex_idx::create(pt->get_ie(), append_name(pt->get_e(), s));
     } else if (t == SYMB) {
-        return ex_symb::create(stringhash::get_instance().append(p.get<ex_symb>()->m_hash, s));
+        return ex_symb::create(stringhash::get_instance().append(p.get<ex_symb>()->m_name, s));
     } else if (t == SYMBIDX) {
         const ex_symbidx *pt = p.get<ex_symbidx>();
-        return ex_symbidx::create(stringhash::get_instance().append(pt->m_hash, s),
+        return ex_symbidx::create(stringhash::get_instance().append(pt->m_name, s),
                                   pt->m_noid, pt->m_idx1, pt->m_idx2, pt->m_idx3, pt->m_idx4);
     } else if (t == VART) {
-        return ex_vart::create(stringhash::get_instance().append(p.get<ex_vart>()->m_hash, s), 0);
+        return ex_vart::create(stringhash::get_instance().append(p.get<ex_vart>()->m_name, s), 0);
     } else if (t == VARTIDX) {
         const ex_vartidx *pt = p.get<ex_vartidx>();
-        return ex_vartidx::create(stringhash::get_instance().append(pt->m_hash, s), 0,
+        return ex_vartidx::create(stringhash::get_instance().append(pt->m_name, s), 0,
                                   pt->m_noid, pt->m_idx1, pt->m_idx2, pt->m_idx3, pt->m_idx4);
     } else USER_ERROR("append_name expects parameter or variable")
 }
@@ -230,7 +415,7 @@ symbolic::internal::add_idx(const ptr_base &p, const idx_ex &ie)
 //         return add_idx(pt->get_e(), ie);
     } else if (t == SYMB) {
         const ex_symb *pt = p.get<ex_symb>();
-        return ex_symbidx::create(pt->m_hash, 1, ie.m_id, 0, 0, 0);
+        return ex_symbidx::create(pt->m_name, 1, ie.m_id, 0, 0, 0);
     } else if (t == SYMBIDX) {
         if (p->hasidx(ie.m_id)) return p;
         const ex_symbidx *pt = p.get<ex_symbidx>();
@@ -242,10 +427,10 @@ symbolic::internal::add_idx(const ptr_base &p, const idx_ex &ie)
             case 3: i4 = ie.m_id; break;
             default: INTERNAL_ERROR
         }
-        return ex_symbidx::create(pt->m_hash, no + 1, i1, i2, i3, i4);
+        return ex_symbidx::create(pt->m_name, no + 1, i1, i2, i3, i4);
     } else if (t == VART) {
         const ex_vart *pt = p.get<ex_vart>();
-        return ex_vartidx::create(pt->m_hash, pt->m_lag, 1, ie.m_id, 0, 0, 0);
+        return ex_vartidx::create(pt->m_name, pt->m_lag, 1, ie.m_id, 0, 0, 0);
     } else if (t == VARTIDX) {
         if (p->hasidx(ie.m_id)) return p;
         const ex_vartidx *pt = p.get<ex_vartidx>();
@@ -257,7 +442,7 @@ symbolic::internal::add_idx(const ptr_base &p, const idx_ex &ie)
             case 3: i4 = ie.m_id; break;
             default: INTERNAL_ERROR
         }
-        return ex_vartidx::create(pt->m_hash, pt->m_lag, no + 1, i1, i2, i3, i4);
+        return ex_vartidx::create(pt->m_name, pt->m_lag, no + 1, i1, i2, i3, i4);
     } else USER_ERROR("add_idx expects parameter or variable")
 }
 
@@ -298,7 +483,9 @@ symbolic::internal::subst(const ptr_base &p,
         USER_ERROR("trying to substitute for constant with an expression containing variable")
     }
 
-    if (all_leads_lags) {
+    if (p->flag() & RAW) {
+        // searched while rebuilt
+    } else if (all_leads_lags) {
         if (!p->has(what, ANY_T, false)) return p;
     } else {
         if (!p->has(what, EXACT_T, false)) return p;
@@ -309,12 +496,12 @@ symbolic::internal::subst(const ptr_base &p,
         if (tw == EX) {
             int l1 = pt->get_lag(), l2 = ptw->get_lag(), ld = l2 - l1;
             if (ld && (!all_leads_lags))
-                return mk_E(subst(pt->get_arg(), what, with, all_leads_lags), pt->get_lag());
-            if (!compare(lag(pt->get_arg(), ld), ptw->get_arg())) {
+                return mk_E(canon(subst(pt->get_arg(), what, with, all_leads_lags)), pt->get_lag());
+            if (equal(canon(lag(pt->get_arg(), ld)), ptw->get_arg())) {
                 return lag(with, -ld);
             }
         }
-        return mk_E(subst(pt->get_arg(), what, with, all_leads_lags), pt->get_lag());
+        return mk_E(canon(subst(pt->get_arg(), what, with, all_leads_lags)), pt->get_lag());
     } else if (t == tw) { // primitive type that contains what, so is equal
         if (t == SYMB) return with;
         else if (t == SYMBIDX) {
@@ -350,10 +537,10 @@ symbolic::internal::subst(const ptr_base &p,
         } else INTERNAL_ERROR
     } else if (t == SUM) {
         const ex_sum *pt = p.get<ex_sum>();
-        return ex_sum::create(pt->get_ie(), subst(pt->get_e(), what, with, all_leads_lags));
+        return ex_sum::create(pt->get_ie(), canon(subst(pt->get_e(), what, with, all_leads_lags)));
     } else if (t == PROD) {
         const ex_prod *pt = p.get<ex_prod>();
-        return ex_prod::create(pt->get_ie(), subst(pt->get_e(), what, with, all_leads_lags));
+        return ex_prod::create(pt->get_ie(), canon(subst(pt->get_e(), what, with, all_leads_lags)));
     } else if (t == ADD) {
         const num_ex_pair_vec &in = p.get<ex_add>()->get_ops();
         num_ex_pair_vec out;
@@ -362,7 +549,7 @@ symbolic::internal::subst(const ptr_base &p,
         for (i = 0; i < n; ++i)
             out.push_back(std::pair<Number, ptr_base>(
                 in[i].first, subst(in[i].second, what, with, all_leads_lags)));
-        return mk_add(out);
+        return bld_add(p, out);
     } else if (t == MUL) {
         const num_ex_pair_vec &in = p.get<ex_mul>()->get_ops();
         num_ex_pair_vec out;
@@ -371,17 +558,86 @@ symbolic::internal::subst(const ptr_base &p,
         for (i = 0; i < n; ++i)
             out.push_back(std::pair<Number, ptr_base>(
                 in[i].first, subst(in[i].second, what, with, all_leads_lags)));
-        return mk_mul(out);
+        return bld_mul(p, out);
+    } else if (t == POW) {
+        const ex_pow *pt = p.get<ex_pow>();
+        return bld_pow(p, subst(pt->get_base(), what, with, all_leads_lags),
+                          subst(pt->get_exp(), what, with, all_leads_lags));
+    } else if (t == FUN) {
+        const ex_func *pt = p.get<ex_func>();
+        return bld_func(p, pt->get_code(), subst(pt->get_arg(), what, with, all_leads_lags));
+    } else if (t == IDX) {
+        const ex_idx *pt = p.get<ex_idx>();
+        return bld_idx(p, pt->get_ie(), subst(pt->get_e(), what, with, all_leads_lags));
+    } else INTERNAL_ERROR
+}
+
+
+
+
+ptr_base
+symbolic::internal::subst(const ptr_base &p, const subst_list &sl, bool all_leads_lags)
+{
+    // Only pairs with what in p matter here and below
+    subst_list rel;
+    search_flag f = (all_leads_lags) ? ANY_T : EXACT_T;
+    for (subst_list::const_iterator it = sl.begin(); it != sl.end(); ++it) {
+        ptr_base what = it->first, with = it->second;
+        if (what->type() == IDX) what = what.get<ex_idx>()->get_e();
+        if (with->type() == IDX) with = with.get<ex_idx>()->get_ptr();
+        if ((p->flag() & RAW) || p->has(what, f, false)) rel.push_back(std::make_pair(what, with));
+    }
+    if (rel.empty()) return p;
+    if (rel.size() == 1) return subst(p, rel[0].first, rel[0].second, all_leads_lags);
+
+    unsigned t = p->type();
+    if ((t == SYMB) || (t == SYMBIDX) || (t == VART) || (t == VARTIDX)) {
+        return subst(p, rel[0].first, rel[0].second, all_leads_lags);
+    } else if (t == EX) {
+        const ex_e *pt = p.get<ex_e>();
+        for (subst_list::const_iterator it = rel.begin(); it != rel.end(); ++it) {
+            if (it->first->type() != EX) continue;
+            int ld = it->first.get<ex_e>()->get_lag() - pt->get_lag();
+            if (ld && (!all_leads_lags)) continue;
+            if (equal(canon(lag(pt->get_arg(), ld)), it->first.get<ex_e>()->get_arg())) {
+                return lag(it->second, -ld);
+            }
+        }
+        return mk_E(canon(subst(pt->get_arg(), rel, all_leads_lags)), pt->get_lag());
+    } else if (t == SUM) {
+        const ex_sum *pt = p.get<ex_sum>();
+        return ex_sum::create(pt->get_ie(), canon(subst(pt->get_e(), rel, all_leads_lags)));
+    } else if (t == PROD) {
+        const ex_prod *pt = p.get<ex_prod>();
+        return ex_prod::create(pt->get_ie(), canon(subst(pt->get_e(), rel, all_leads_lags)));
+    } else if (t == ADD) {
+        const num_ex_pair_vec &in = p.get<ex_add>()->get_ops();
+        num_ex_pair_vec out;
+        unsigned i, n = in.size();
+        out.reserve(n);
+        for (i = 0; i < n; ++i)
+            out.push_back(std::pair<Number, ptr_base>(
+                in[i].first, subst(in[i].second, rel, all_leads_lags)));
+        return bld_add(p, out);
+    } else if (t == MUL) {
+        const num_ex_pair_vec &in = p.get<ex_mul>()->get_ops();
+        num_ex_pair_vec out;
+        unsigned i, n = in.size();
+        out.reserve(n);
+        for (i = 0; i < n; ++i)
+            out.push_back(std::pair<Number, ptr_base>(
+                in[i].first, subst(in[i].second, rel, all_leads_lags)));
+        return bld_mul(p, out);
     } else if (t == POW) {
         const ex_pow *pt = p.get<ex_pow>();
-        return mk_pow(subst(pt->get_base(), what, with, all_leads_lags),
-                      subst(pt->get_exp(), what, with, all_leads_lags));
+        return bld_pow(p, subst(pt->get_base(), rel, all_leads_lags),
+                          subst(pt->get_exp(), rel, all_leads_lags));
     } else if (t == FUN) {
         const ex_func *pt = p.get<ex_func>();
-        return mk_func(pt->get_code(), subst(pt->get_arg(), what, with, all_leads_lags));
+        return bld_func(p, pt->get_code(), subst(pt->get_arg(), rel, all_leads_lags));
     } else if (t == IDX) {
         const ex_idx *pt = p.get<ex_idx>();
-        return ex_idx::create(pt->get_ie(), subst(pt->get_e(), what, with, all_leads_lags));
+        return bld_idx(p, pt->get_ie(), subst(pt->get_e(), rel, all_leads_lags));
     } else INTERNAL_ERROR
 }
 
@@ -391,7 +647,7 @@ symbolic::internal::subst(const ptr_base &p,
 ptr_base
 symbolic::internal::substidx(const ptr_base &p, unsigned what, int with)
 {
-    if (!p->hasidx(what)) return p;
+    if (!(p->flag() & RAW) && !p->hasidx(what)) return p;
     unsigned t = p->type();
     if (t == DELTA) {
         return p.get<ex_delta>()->substidx(what, with);
@@ -402,17 +658,17 @@ symbolic::internal::substidx(const ptr_base &p, unsigned what, int with)
     } else if (t == SUM) {
         const ex_sum *pt = p.get<ex_sum>();
         if (pt->get_ie().get_id() == what) return substidx(pt->reindex(), what, with);
-        else return ex_sum::create(pt->get_ie().substidx(what, with), substidx(pt->get_e(), what, with));
+        else return ex_sum::create(pt->get_ie().substidx(what, with), canon(substidx(pt->get_e(), what, with)));
     } else if (t == PROD) {
         const ex_prod *pt = p.get<ex_prod>();
         if (pt->get_ie().get_id() == what) return substidx(pt->reindex(), what, with);
-        else return ex_prod::create(pt->get_ie().substidx(what, with), substidx(pt->get_e(), what, with));
+        else return ex_prod::create(pt->get_ie().substidx(what, with), canon(substidx(pt->get_e(), what, with)));
     } else if (t == IDX) {
         const ex_idx *pt = p.get<ex_idx>();
-        return ex_idx::create(pt->get_ie().substidx(what, with), substidx(pt->get_e(), what, with));
+        return bld_idx(p, pt->get_ie().substidx(what, with), substidx(pt->get_e(), what, with));
     } else if (t == EX) {
         const ex_e *pt = p.get<ex_e>();
-        return mk_E(substidx(pt->get_arg(), what, with), pt->get_lag());
+        return mk_E(canon(substidx(pt->get_arg(), what, with)), pt->get_lag());
     } else if (t == ADD) {
         const num_ex_pair_vec &in = p.get<ex_add>()->get_ops();
         num_ex_pair_vec out;
@@ -421,7 +677,7 @@ symbolic::internal::substidx(const ptr_base &p, unsigned what, int with)
         for (i = 0; i < n; ++i)
             out.push_back(std::pair<Number, ptr_base>(
                 in[i].first, substidx(in[i].second, what, with)));
-        return mk_add(out);
+        return bld_add(p, out);
     } else if (t == MUL) {
         const num_ex_pair_vec &in = p.get<ex_mul>()->get_ops();
         num_ex_pair_vec out;
@@ -430,17 +686,162 @@ symbolic::internal::substidx(const ptr_base &p, unsigned what, int with)
         for (i = 0; i < n; ++i)
             out.push_back(std::pair<Number, ptr_base>(
                 in[i].first, substidx(in[i].second, what, with)));
-        return mk_mul(out);
+        return bld_mul(p, out);
+    } else if (t == POW) {
+        const ex_pow *pt = p.get<ex_pow>();
+        return bld_pow(p, substidx(pt->get_base(), what, with),
+                          substidx(pt->get_exp(), what, with));
+    } else if (t == FUN) {
+        const ex_func *pt = p.get<ex_func>();
+        return bld_func(p, pt->get_code(), substidx(pt->get_arg(), what, with));
+    } else INTERNAL_ERROR;
+}
+
+
+
+ptr_base
+symbolic::internal::substidx(const ptr_base &p, const idx_ren &iv)
+{
+    unsigned i, j, n = iv.size(), t = p->type(), noid = 2;
+    int id[4];
+    if (t == DELTA) {
+        const ex_delta *pt = p.get<ex_delta>();
+        id[0] = pt->m_idx1; id[1] = pt->m_idx2;
+    } else if (t == SYMBIDX) {
+        const ex_symbidx *pt = p.get<ex_symbidx>();
+        noid = pt->m_noid;
+        id[0] = pt->m_idx1; id[1] = pt->m_idx2; id[2] = pt->m_idx3; id[3] = pt->m_idx4;
+    } else if (t == VARTIDX) {
+        const ex_vartidx *pt = p.get<ex_vartidx>();
+        noid = pt->m_noid;
+        id[0] = pt->m_idx1; id[1] = pt->m_idx2; id[2] = pt->m_idx3; id[3] = pt->m_idx4;
+    } else {
+        ptr_base res = p;
+        for (i = 0; i < n; ++i) res = substidx(res, iv[i].first, iv[i].second);
+        return res;
+    }
+    bool ch = false;
+    for (i = 0; i < noid; ++i) {
+        for (j = 0; j < n; ++j) {
+            if (id[i] == (int) iv[j].first) {
+                id[i] = iv[j].second;
+                ch = true;
+            }
+        }
+    }
+    if (!ch) return p;
+    if (t == DELTA) {
+        return ex_delta::create(id[0], id[1]);
+    } else if (t == SYMBIDX) {
+        return ex_symbidx::create(p.get<ex_symbidx>()->m_name, noid, id[0], id[1], id[2], id[3]);
+    }
+    const ex_vartidx *pt = p.get<ex_vartidx>();
+    return ex_vartidx::create(pt->m_name, pt->m_lag, noid, id[0], id[1], id[2], id[3]);
+}
+
+
+ptr_base
+symbolic::internal::free_idx(const ptr_base &p, idx_ren &iv)
+{
+    // Free indices are named so that they cannot clash with user indices
+    static const char *names[] = { "?1", "?2", "?3", "?4" };
+    unsigned t = p->type(), i, noid;
+    int id[4];
+    if (t == VARTIDX) {
+        const ex_vartidx *pt = p.get<ex_vartidx>();
+        noid = pt->m_noid;
+        id[0] = pt->m_idx1; id[1] = pt->m_idx2; id[2] = pt->m_idx3; id[3] = pt->m_idx4;
+    } else if (t == SYMBIDX) {
+        const ex_symbidx *pt = p.get<ex_symbidx>();
+        noid = pt->m_noid;
+        id[0] = pt->m_idx1; id[1] = pt->m_idx2; id[2] = pt->m_idx3; id[3] = pt->m_idx4;
+    } else return p;
+    for (i = 0; i < noid; ++i) {
+        if (id[i] >= 0) continue;
+        int f = stringhash::get_instance().get_hash(names[i]);
+        iv.push_back(std::pair<unsigned, int>(f, id[i]));
+        id[i] = f;
+    }
+    if (t == VARTIDX) {
+        const ex_vartidx *pt = p.get<ex_vartidx>();
+        return ex_vartidx::create(pt->m_name, pt->m_lag, noid, id[0], id[1], id[2], id[3]);
+    }
+    return ex_symbidx::create(p.get<ex_symbidx>()->m_name, noid, id[0], id[1], id[2], id[3]);
+}
+
+
+namespace {
+
+// See instidx, var is set if result depends on indices iv[nc], iv[nc + 1], ...
+ptr_base
+instidx_var(const ptr_base &p, const idx_ren &iv, unsigned nc, inst_cache &cache, bool &var)
+{
+    unsigned i, n = iv.size(), t = p->type();
+    var = false;
+    if ((t == NUM) || (t == SYMB) || (t == VART)) return p;
+    if ((t == DELTA) || (t == SYMBIDX) || (t == VARTIDX)) {
+        for (i = nc; (i < n) && !var; ++i) var = p->hasidx(iv[i].first);
+        return substidx(p, iv);
+    }
+    inst_cache::const_iterator it = cache.find(p.get());
+    if (it != cache.end()) return it->second.second;
+    ptr_base res = p;
+    if (!(p->flag() & HASIDX)) {
+        res = expandsp(p);
+    } else if ((t == SUM) || (t == PROD)) {
+        for (i = nc; (i < n) && !var; ++i) var = p->hasidx(iv[i].first);
+        ptr_base e = substidx(p, iv);
+        if ((e->type() != SUM) || !e.get<ex_sum>()->expand_delta(res)) res = expandsp(e);
+    } else if (t == EX) {
+        const ex_e *pt = p.get<ex_e>();
+        res = mk_E(instidx_var(pt->get_arg(), iv, nc, cache, var), pt->get_lag());
+    } else if ((t == ADD) || (t == MUL)) {
+        const num_ex_pair_vec &in = (t == ADD) ? p.get<ex_add>()->get_ops()
+                                               : p.get<ex_mul>()->get_ops();
+        num_ex_pair_vec out;
+        unsigned m = in.size();
+        bool v;
+        if (t == MUL) {
+            // Product of Kronecker deltas is checked first
+            for (i = 0; i < m; ++i) {
+                if (in[i].second->type() != DELTA) continue;
+                if (instidx_var(in[i].second, iv, nc, cache, v)->is0()) {
+                    var = v;
+                    return ex_num::zero();
+                }
+            }
+        }
+        out.reserve(m);
+        for (i = 0; i < m; ++i) {
+            out.push_back(std::pair<Number, ptr_base>(in[i].first,
+                                                      instidx_var(in[i].second, iv, nc, cache, v)));
+            var = var || v;
+        }
+        res = (t == ADD) ? mk_add(out) : mk_mul(out);
     } else if (t == POW) {
         const ex_pow *pt = p.get<ex_pow>();
-        return mk_pow(substidx(pt->get_base(), what, with),
-                      substidx(pt->get_exp(), what, with));
+        bool v;
+        ptr_base b = instidx_var(pt->get_base(), iv, nc, cache, var);
+        res = mk_pow(b, instidx_var(pt->get_exp(), iv, nc, cache, v));
+        var = var || v;
     } else if (t == FUN) {
         const ex_func *pt = p.get<ex_func>();
-        return mk_func(pt->get_code(), substidx(pt->get_arg(), what, with));
+        res = mk_func(pt->get_code(), instidx_var(pt->get_arg(), iv, nc, cache, var));
     } else INTERNAL_ERROR;
+    if (!var) cache.insert(std::make_pair(p.get(), std::make_pair(p, res)));
+    return res;
 }
 
+} /* namespace */
+
+
+ptr_base
+symbolic::internal::instidx(const ptr_base &p, const idx_ren &iv, unsigned nc,
+                            inst_cache &cache)
+{
+    bool var;
+    return instidx_var(p, iv, nc, cache, var);
+}
 
 
 ptr_base
@@ -456,7 +857,7 @@ symbolic::internal::expandsp(const ptr_base &p)
         return p.get<ex_prod>()->expand();
     } else if (t == EX) {
         const ex_e *pt = p.get<ex_e>();
-        return mk_E(expandsp(pt->get_arg()), pt->get_lag());
+        return mk_E(canon(expandsp(pt->get_arg())), pt->get_lag());
     } else if (t == ADD) {
         const num_ex_pair_vec &in = p.get<ex_add>()->get_ops();
         num_ex_pair_vec out;
@@ -465,7 +866,7 @@ symbolic::internal::expandsp(const ptr_base &p)
         for (i = 0; i < n; ++i)
             out.push_back(std::pair<Number, ptr_base>(in[i].first,
                                                       expandsp(in[i].second)));
-        return mk_add(out);
+        return bld_add(p, out);
     } else if (t == MUL) {
         const num_ex_pair_vec &in = p.get<ex_mul>()->get_ops();
         num_ex_pair_vec out;
@@ -474,18 +875,209 @@ symbolic::internal::expandsp(const ptr_base &p)
         for (i = 0; i < n; ++i)
             out.push_back(std::pair<Number, ptr_base>(in[i].first,
                                                       expandsp(in[i].second)));
-        return mk_mul(out);
+        return bld_mul(p, out);
     } else if (t == POW) {
         const ex_pow *pt = p.get<ex_pow>();
-        return mk_pow(expandsp(pt->get_base()), expandsp(pt->get_exp()));
+        return bld_pow(p, expandsp(pt->get_base()), expandsp(pt->get_exp()));
     } else if (t == FUN) {
         const ex_func *pt = p.get<ex_func>();
-        return mk_func(pt->get_code(), expandsp(pt->get_arg()));
+        return bld_func(p, pt->get_code(), expandsp(pt->get_arg()));
     } else INTERNAL_ERROR;
 }
 
 
 
 
+namespace {
+
+// Is expression positive for all real values of variables and parameters?
+bool
+positive(const ptr_base &p)
+{
+    unsigned t = p->type();
+    if (t == NUM) return (p->val() > 0.);
+    if (t == FUN) return (p.get<ex_func>()->get_code() == EXP);
+    if (t == POW) return positive(p.get<ex_pow>()->get_base());
+    if (t == EX) return positive(p.get<ex_e>()->get_arg());
+    if ((t == ADD) || (t == MUL)) {
+        const num_ex_pair_vec &in = (t == ADD) ? p.get<ex_add>()->get_ops()
+                                               : p.get<ex_mul>()->get_ops();
+        for (unsigned i = 0, n = in.size(); i < n; ++i) {
+            if ((t == ADD) && (in[i].first <= 0.)) return false;
+            if (!positive(in[i].second)) return false;
+        }
+        return true;
+    }
+    return false;
+}
+
+bool
+is_func(const ptr_base &p, func_code c)
+{
+    return (p->type() == FUN) && (p.get<ex_func>()->get_code() == c);
+}
+
+// Simplification rules. A rule applies to node of a given type (with
+// simplified operands) and returns true if it rewrote the node. Rules
+// hold for all real values of variables and parameters; where they do
+// not, the domain is checked with positive(). (x^a)^b -> x^(a * b) and
+// (x^a)^c -> x^(a * c) for products are done by mk_pow.
+
+// log(exp(x)) -> x
+bool
+rule_log_exp(const ptr_base &p, ptr_base &res)
+{
+    const ex_func *pt = p.get<ex_func>();
+    if ((pt->get_code() != LOG) || !is_func(pt->get_arg(), EXP)) return false;
+    res = pt->get_arg().get<ex_func>()->get_arg();
+    return true;
+}
+
+// exp(log(x)) -> x, x > 0
+bool
+rule_exp_log(const ptr_base &p, ptr_base &res)
+{
+    const ex_func *pt = p.get<ex_func>();
+    if ((pt->get_code() != EXP) || !is_func(pt->get_arg(), LOG)) return false;
+    const ptr_base &x = pt->get_arg().get<ex_func>()->get_arg();
+    if (!positive(x)) return false;
+    res = x;
+    return true;
+}
+
+// log(x^a) -> a * log(x), x > 0 and not a number
+bool
+rule_log_pow(const ptr_base &p, ptr_base &res)
+{
+    const ex_func *pt = p.get<ex_func>();
+    if (pt->get_code() != LOG) return false;
+    const ptr_base &a = pt->get_arg();
+    if (a->type() == POW) {
+        const ex_pow *pp = a.get<ex_pow>();
+        // log(c) of a number c would be evaluated and printed rounded,
+        // log(c^a) is kept
+        if ((pp->get_base()->type() == NUM) || !positive(pp->get_base())) return false;
+        res = mk_mul(pp->get_exp(), mk_func(LOG, pp->get_base()));
+        return true;
+    }
+    // x^c with numeric c is a single factor product
+    if ((a->type() == MUL) && (a->flag() & SINGLE)) {
+        const num_ex_pair &op = a.get<ex_mul>()->get_ops()[0];
+        if (!positive(op.second)) return false;
+        res = mk_mul(ex_num::create(op.first), mk_func(LOG, op.second));
+        return true;
+    }
+    return false;
+}
+
+// exp(x)^a -> exp(a * x)
+bool
+rule_pow_exp(const ptr_base &p, ptr_base &res)
+{
+    const ex_pow *pt = p.get<ex_pow>();
+    if (!is_func(pt->get_base(), EXP)) return false;
+    res = mk_func(EXP, mk_mul(pt->get_exp(), pt->get_base().get<ex_func>()->get_arg()));
+    return true;
+}
+
+// exp(a)^c * exp(b)^d -> exp(c * a + d * b)
+bool
+rule_mul_exp(const ptr_base &p, ptr_base &res)
+{
+    const num_ex_pair_vec &in = p.get<ex_mul>()->get_ops();
+    num_ex_pair_vec rest, args;
+    for (unsigned i = 0, n = in.size(); i < n; ++i) {
+        if (is_func(in[i].second, EXP)) {
+            args.push_back(num_ex_pair(in[i].first, in[i].second.get<ex_func>()->get_arg()));
+        } else {
+            rest.push_back(in[i]);
+        }
+    }
+    if (args.empty() || ((args.size() == 1) && (args[0].first == 1.))) return false;
+    rest.push_back(num_ex_pair(1., mk_func(EXP, mk_add(args))));
+    res = mk_mul(rest);
+    return true;
+}
+
+struct simpl_rule {
+    unsigned type;
+    bool (*rule)(const ptr_base&, ptr_base&);
+};
+
+const simpl_rule simpl_rules[] = {
+    { FUN, rule_log_exp },
+    { FUN, rule_exp_log },
+    { FUN, rule_log_pow },
+    { POW, rule_pow_exp },
+    { MUL, rule_mul_exp }
+};
+
+// Simplified expressions
+typedef std::map<const ex_base*, ptr_base> simpl_map;
 
+ptr_base simpl(const ptr_base &p, simpl_map &sm);
 
+// Node rebuilt from simplified operands
+ptr_base
+simpl_ops(const ptr_base &p, simpl_map &sm)
+{
+    unsigned t = p->type();
+    if ((t == ADD) || (t == MUL)) {
+        const num_ex_pair_vec &in = (t == ADD) ? p.get<ex_add>()->get_ops()
+                                               : p.get<ex_mul>()->get_ops();
+        num_ex_pair_vec out;
+        unsigned i, n = in.size();
+        out.reserve(n);
+        for (i = 0; i < n; ++i)
+            out.push_back(num_ex_pair(in[i].first, simpl(in[i].second, sm)));
+        return (t == ADD) ? mk_add(out) : mk_mul(out);
+    } else if (t == POW) {
+        const ex_pow *pt = p.get<ex_pow>();
+        return mk_pow(simpl(pt->get_base(), sm), simpl(pt->get_exp(), sm));
+    } else if (t == FUN) {
+        const ex_func *pt = p.get<ex_func>();
+        return mk_func(pt->get_code(), simpl(pt->get_arg(), sm));
+    } else if (t == EX) {
+        const ex_e *pt = p.get<ex_e>();
+        return mk_E(simpl(pt->get_arg(), sm), pt->get_lag());
+    } else if (t == IDX) {
+        const ex_idx *pt = p.get<ex_idx>();
+        return ex_idx::create(pt->get_ie(), simpl(pt->get_e(), sm));
+    } else if (t == SUM) {
+        const ex_sum *pt = p.get<ex_sum>();
+        return ex_sum::create(pt->get_ie(), simpl(pt->get_e(), sm));
+    } else if (t == PROD) {
+        const ex_prod *pt = p.get<ex_prod>();
+        return ex_prod::create(pt->get_ie(), simpl(pt->get_e(), sm));
+    }
+    return p;
+}
+
+ptr_base
+simpl(const ptr_base &p, simpl_map &sm)
+{
+    unsigned t = p->type();
+    if ((t == NUM) || (t == DELTA) || (t == SYMB) || (t == SYMBIDX)
+        || (t == VART) || (t == VARTIDX)) return p;
+    simpl_map::const_iterator it = sm.find(p.get());
+    if (it != sm.end()) return it->second;
+    ptr_base res = simpl_ops(p, sm);
+    // Each rule removes a function or power, so this terminates
+    const unsigned nr = sizeof(simpl_rules) / sizeof(simpl_rules[0]);
+    for (unsigned i = 0; i < nr; ) {
+        ptr_base cur = res;
+        if ((simpl_rules[i].type == cur->type()) && simpl_rules[i].rule(cur, res)) i = 0;
+        else ++i;
+    }
+    return sm.insert(std::make_pair(p.get(), res)).first->second;
+}
+
+} /* namespace */
+
+
+ptr_base
+symbolic::internal::simplify(const ptr_base &p)
+{
+    simpl_map sm;
+    return simpl(p, sm);
+}
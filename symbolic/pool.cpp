@@ -0,0 +1,147 @@
+/*****************************************************************************
+ * This file is a part of gEcon.                                             *
+ *                                                                           *
+ * (c) Chancellery of the Prime Minister of the Republic of Poland 2012-2015 *
+ * (c) Grzegorz Klima, Karol Podemski, Kaja Retkiewicz-Wijtiwiak 2015-2016   *
+ * License terms can be found in the file 'LICENCE'                          *
+ *                                                                           *
+ * Author: Grzegorz Klima                                                    *
+ *****************************************************************************/
+
+/** \file pool.cpp
+ * \brief Size-class pool allocator for expression nodes.
+ */
+
+#include <pool.h>
+#include <utils.h>
+#include <new>
+
+
+using namespace symbolic::internal;
+
+
+namespace {
+
+const std::size_t chunk_size = 65536;
+
+} /* namespace */
+
+
+
+node_pool::node_pool(std::size_t size)
+    : m_size(size), m_free(0), m_allocs(0), m_live(0), m_peak(0)
+{
+}
+
+
+
+void
+node_pool::grow()
+{
+    std::size_t n = chunk_size / m_size;
+    char *c = static_cast<char*>(::operator new(n * m_size));
+    m_chunks.push_back(c);
+    for (std::size_t i = n; i > 0; --i) {
+        void *p = c + (i - 1) * m_size;
+        *static_cast<void**>(p) = m_free;
+        m_free = p;
+    }
+}
+
+
+
+void
+node_pool::release()
+{
+    for (std::vector<char*>::iterator it = m_chunks.begin(); it != m_chunks.end(); ++it)
+        ::operator delete(*it);
+    std::vector<char*>().swap(m_chunks);
+    m_free = 0;
+    m_allocs = m_live = m_peak = 0;
+}
+
+
+
+node_pools::node_pools()
+    : m_large(0), m_large_allocs(0), m_large_live(0), m_dropping(false)
+{
+    for (std::size_t i = 0; i < max_size / granularity; ++i)
+        m_pools[i] = node_pool((i + 1) * granularity);
+}
+
+
+
+void*
+node_pools::alloc_large(std::size_t sz)
+{
+    large_hdr *h = static_cast<large_hdr*>(::operator new(sizeof(large_hdr) + sz));
+    h->l.prev = 0;
+    h->l.next = m_large;
+    if (m_large) m_large->l.prev = h;
+    m_large = h;
+    ++m_large_allocs;
+    ++m_large_live;
+    return h + 1;
+}
+
+
+
+void
+node_pools::free_large(void *p)
+{
+    large_hdr *h = static_cast<large_hdr*>(p) - 1;
+    if (h->l.prev) h->l.prev->l.next = h->l.next;
+    else m_large = h->l.next;
+    if (h->l.next) h->l.next->l.prev = h->l.prev;
+    ::operator delete(h);
+    --m_large_live;
+}
+
+
+
+void
+node_pools::drop()
+{
+    for (std::size_t i = 0; i < max_size / granularity; ++i)
+        m_pools[i].release();
+    while (m_large) {
+        large_hdr *h = m_large;
+        m_large = h->l.next;
+        ::operator delete(h);
+    }
+    m_large_allocs = m_large_live = 0;
+    m_dropping = false;
+}
+
+
+
+unsigned long
+node_pools::live() const
+{
+    unsigned long res = m_large_live;
+    for (std::size_t i = 0; i < max_size / granularity; ++i)
+        res += m_pools[i].live();
+    return res;
+}
+
+
+
+std::string
+node_pools::stats() const
+{
+    std::string res;
+    for (std::size_t i = 0; i < max_size / granularity; ++i) {
+        const node_pool &p = m_pools[i];
+        if (!p.allocs()) continue;
+        res += "    block size " + num2str((unsigned) p.size())
+            + ": " + num2str((unsigned) p.allocs()) + " allocations, "
+            + num2str((unsigned) p.live()) + " in use, peak "
+            + num2str((unsigned) p.peak()) + ", "
+            + num2str((unsigned) p.chunks()) + " chunk(s)\n";
+    }
+    if (m_large_allocs) {
+        res += "    large blocks: " + num2str((unsigned) m_large_allocs)
+            + " allocations, " + num2str((unsigned) m_large_live) + " in use\n";
+    }
+    return res;
+}
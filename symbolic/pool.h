@@ -0,0 +1,167 @@
+/*****************************************************************************
+ * This file is a part of gEcon.                                             *
+ *                                                                           *
+ * (c) Chancellery of the Prime Minister of the Republic of Poland 2012-2015 *
+ * (c) Grzegorz Klima, Karol Podemski, Kaja Retkiewicz-Wijtiwiak 2015-2016   *
+ * License terms can be found in the file 'LICENCE'                          *
+ *                                                                           *
+ * Author: Grzegorz Klima                                                    *
+ *****************************************************************************/
+
+/** \file pool.h
+ * \brief Size-class pool allocator for expression nodes.
+ */
+
+#ifndef SYMBOLIC_POOL_H
+
+#define SYMBOLIC_POOL_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+
+namespace symbolic {
+namespace internal {
+
+
+/// Free-list pool of blocks of a fixed size. Blocks are carved from
+/// large chunks, freed blocks are kept on a free list for reuse.
+class node_pool
+{
+  public:
+    /// Constructor
+    explicit node_pool(std::size_t size = 0);
+
+    /// Allocate block
+    void* alloc()
+    {
+        if (!m_free) grow();
+        void *p = m_free;
+        m_free = *static_cast<void**>(p);
+        ++m_allocs;
+        if (++m_live > m_peak) m_peak = m_live;
+        return p;
+    }
+
+    /// Return block to the pool
+    void free(void *p)
+    {
+        *static_cast<void**>(p) = m_free;
+        m_free = p;
+        --m_live;
+    }
+
+    /// Return all chunks to the system in one step, blocks still in use
+    /// are dropped. Statistics are reset.
+    void release();
+
+    /// Block size
+    std::size_t size() const { return m_size; }
+    /// Number of allocations
+    unsigned long allocs() const { return m_allocs; }
+    /// Number of blocks in use
+    unsigned long live() const { return m_live; }
+    /// Max number of blocks in use
+    unsigned long peak() const { return m_peak; }
+    /// Number of chunks allocated
+    unsigned long chunks() const { return m_chunks.size(); }
+
+  private:
+    // Block size
+    std::size_t m_size;
+    // Free list
+    void *m_free;
+    // Chunks
+    std::vector<char*> m_chunks;
+    // Statistics
+    unsigned long m_allocs, m_live, m_peak;
+    // Allocate new chunk
+    void grow();
+
+}; /* class node_pool */
+
+
+
+/// Singleton class holding size-class pools for expression nodes and
+/// their operand vectors. Larger blocks are taken from the system and
+/// linked in a list, so that all memory can be dropped in one step.
+///
+/// Pools serve as a per-model arena: Model::clear() switches dropping
+/// nodes on, releases references held by the model and caches (nodes
+/// whose last reference is released are not destroyed, see
+/// ptr_base::dec_rc) and calls drop(), which frees all memory without
+/// visiting nodes. DEBUG builds free nodes through reference counts
+/// instead and check that no block is in use before drop().
+class node_pools
+{
+  public:
+    /// Allocate memory
+    void* alloc(std::size_t sz)
+    {
+        if (sz > max_size) return alloc_large(sz);
+        return m_pools[size_class(sz)].alloc();
+    }
+
+    /// Free memory
+    void free(void *p, std::size_t sz)
+    {
+        if (sz > max_size) { free_large(p); return; }
+        m_pools[size_class(sz)].free(p);
+    }
+
+    /// Start dropping nodes
+    void begin_drop() { m_dropping = true; }
+    /// Are nodes being dropped?
+    bool dropping() const { return m_dropping; }
+    /// Free all memory in one step and stop dropping nodes. Blocks in
+    /// use must not be accessed afterwards.
+    void drop();
+
+    /// Number of blocks in use
+    unsigned long live() const;
+    /// Allocator statistics
+    std::string stats() const;
+
+    /// Get instance
+    static node_pools& get_instance()
+    {
+        // Never destroyed, nodes held by static objects may outlive it
+        static node_pools *instance = new node_pools;
+        return *instance;
+    }
+
+  private:
+    // Size classes
+    static const std::size_t granularity = 8;
+    static const std::size_t max_size = 256;
+    static std::size_t size_class(std::size_t sz) { return (sz - 1) / granularity; }
+    // Pools
+    node_pool m_pools[max_size / granularity];
+    // Header of large block (aligned as memory from operator new)
+    union large_hdr {
+        struct { large_hdr *prev, *next; } l;
+        std::max_align_t align;
+    };
+    // List of large blocks
+    large_hdr *m_large;
+    // Statistics of large blocks
+    unsigned long m_large_allocs, m_large_live;
+    // Dropping nodes?
+    bool m_dropping;
+    // Large blocks
+    void* alloc_large(std::size_t sz);
+    void free_large(void *p);
+    // Constructor is private
+    node_pools();
+    // Private, too. Not implemented.
+    node_pools(node_pools const& copy);
+    node_pools& operator=(node_pools const& copy);
+
+}; /* class node_pools */
+
+
+} /* namespace internal */
+} /* namespace symbolic */
+
+#endif /* SYMBOLIC_POOL_H */
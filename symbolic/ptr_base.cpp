@@ -29,23 +29,21 @@
 #include <ex_sum.h>
 #include <ex_prod.h>
 #include <ex_idx.h>
+#include <unique_table.h>
 #include <error.h>
 
 
 using namespace symbolic::internal;
 
 
+ex_base *ptr_base::s_zero = 0;
+
 
 // Constructor
 ptr_base::ptr_base(ex_base *p)
 {
     m_p = p;
-    if (m_p) {
-        m_rc = new int;
-        *m_rc = 1;
-    } else {
-        m_rc = 0;
-    }
+    if (m_p) ++m_p->m_rc;
 }
 
 
@@ -53,24 +51,26 @@ ptr_base::ptr_base(ex_base *p)
 ptr_base::ptr_base(const ptr_base& p)
 {
     m_p = p.m_p;
-    m_rc = p.m_rc;
-    if (m_rc) ++(*m_rc);
+    if (m_p) ++m_p->m_rc;
 }
 
 
 void
-ptr_base::dec_rc()
+ptr_base::dec_rc(ex_base *p)
 {
-    if (m_rc) {
-        if (--(*m_rc) == 0) {
-            delete m_rc;
-            switch (m_p->type()) {
+    if (p) {
+        if (--p->m_rc == 0) {
+            // Dropped nodes are freed with the pools (see node_pools::drop)
+            if (node_pools::get_instance().dropping()) return;
+            // Raw nodes are not in the unique table
+            if (!(p->flag() & RAW)) unique_table::get_instance().erase(p);
+            switch (p->type()) {
 #ifdef EXPAND_CASE
 #undef EXPAND_CASE
 #endif
 #define EXPAND_CASE(TYPE, CLASS) \
                 case TYPE: \
-                    CLASS::destroy(m_p); \
+                    CLASS::destroy(p); \
                     break;
                 EXPAND_CASE(NUM, ex_num)
                 EXPAND_CASE(DELTA, ex_delta)
@@ -96,7 +96,7 @@ ptr_base::dec_rc()
 // Destructor
 ptr_base::~ptr_base()
 {
-    dec_rc();
+    dec_rc(m_p);
 }
 
 
@@ -105,15 +105,45 @@ ptr_base&
 ptr_base::operator=(const ptr_base& p)
 {
     if (m_p != p.m_p) {
-        dec_rc();
+        ex_base *old = m_p;
         m_p = p.m_p;
-        m_rc = p.m_rc;
-        if (m_rc) ++(*m_rc);
+        if (m_p) ++m_p->m_rc;
+        dec_rc(old);
     }
     return *this;
 }
 
 
+// Shared node of number 0 with reference count incremented
+ex_base*
+ptr_base::zero_node()
+{
+    if (!s_zero) {
+        // Shared node holds a reference of its own
+        ptr_base z = ex_num::create(0.);
+        s_zero = z.m_p;
+        ++s_zero->m_rc;
+    }
+    ++s_zero->m_rc;
+    return s_zero;
+}
 
 
+// Number 0
+ptr_base
+ptr_base::zero()
+{
+    ptr_base res(0);
+    res.m_p = zero_node();
+    return res;
+}
+
 
+// Release shared node of number 0
+void
+ptr_base::release_zero()
+{
+    ex_base *p = s_zero;
+    s_zero = 0;
+    dec_rc(p);
+}
@@ -18,6 +18,7 @@
 
 #include <decl.h>
 #include <algorithm>
+#include <utility>
 
 namespace symbolic {
 namespace internal {
@@ -31,11 +32,29 @@ class ptr_base {
     explicit ptr_base(ex_base *p);
     /// Copy constructor
     ptr_base(const ptr_base& p);
+    /// Move constructor (p is left holding number 0, as default ex)
+    ptr_base(ptr_base&& p) noexcept : m_p(p.m_p) { p.m_p = zero_node(); }
     /// Destructor
     ~ptr_base();
 
     /// Assignment
     ptr_base& operator=(const ptr_base& p);
+    /// Move assignment (p is left holding number 0, previous node is released)
+    ptr_base& operator=(ptr_base&& p) noexcept
+    {
+        if (this != &p) {
+            ex_base *old = m_p;
+            m_p = p.m_p;
+            p.m_p = zero_node();
+            dec_rc(old);
+        }
+        return *this;
+    }
+
+    /// Number 0 (shared node, kept until release_zero())
+    static ptr_base zero();
+    /// Release shared node of number 0 (before nodes are dropped)
+    static void release_zero();
 
     /// Reference
     ex_base& operator*() { return *m_p; }
@@ -56,8 +75,11 @@ class ptr_base {
     // No default constructor
     ptr_base();
     ex_base *m_p;
-    int *m_rc;
-    void dec_rc();
+    static void dec_rc(ex_base *p);
+    // Shared node of number 0
+    static ex_base *s_zero;
+    // Shared node of number 0 with reference count incremented
+    static ex_base* zero_node();
 
 }; /* class ptr_base */
 
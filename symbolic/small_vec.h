@@ -0,0 +1,246 @@
+/*****************************************************************************
+ * This file is a part of gEcon.                                             *
+ *                                                                           *
+ * (c) Chancellery of the Prime Minister of the Republic of Poland 2012-2015 *
+ * (c) Grzegorz Klima, Karol Podemski, Kaja Retkiewicz-Wijtiwiak 2015-2016   *
+ * License terms can be found in the file 'LICENCE'                          *
+ *                                                                           *
+ * Author: Grzegorz Klima                                                    *
+ *****************************************************************************/
+
+/** \file small_vec.h
+ * \brief Vector with inline storage for a small number of elements.
+ */
+
+#ifndef SYMBOLIC_SMALL_VEC_H
+
+#define SYMBOLIC_SMALL_VEC_H
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <pool.h>
+
+
+namespace symbolic {
+namespace internal {
+
+
+/// Vector keeping up to N elements inline; larger vectors are moved to
+/// node pools (dropped with nodes, see node_pools). Iterators are plain
+/// pointers and are invalidated by any operation that changes size, as
+/// for std::vector.
+template <typename T, unsigned N>
+class small_vec {
+  public:
+    typedef T value_type;
+    typedef T& reference;
+    typedef const T& const_reference;
+    typedef T* iterator;
+    typedef const T* const_iterator;
+    typedef std::size_t size_type;
+    typedef std::ptrdiff_t difference_type;
+
+    /// Default constructor.
+    small_vec() : m_data(inl()), m_size(0), m_cap(N) { ; }
+    /// Copy constructor
+    small_vec(const small_vec &v) : m_data(inl()), m_size(0), m_cap(N)
+    {
+        insert(end(), v.begin(), v.end());
+    }
+    /// Move constructor
+    small_vec(small_vec &&v) noexcept : m_data(inl()), m_size(0), m_cap(N)
+    {
+        steal(v);
+    }
+    /// Destructor
+    ~small_vec()
+    {
+        clear();
+        if (!is_inline()) release(m_data, m_cap);
+    }
+
+    /// Assignment
+    small_vec& operator=(const small_vec &v)
+    {
+        if (this == &v) return *this;
+        clear();
+        insert(end(), v.begin(), v.end());
+        return *this;
+    }
+    /// Move assignment
+    small_vec& operator=(small_vec &&v) noexcept
+    {
+        if (this == &v) return *this;
+        clear();
+        if (!is_inline()) {
+            release(m_data, m_cap);
+            m_data = inl();
+            m_cap = N;
+        }
+        steal(v);
+        return *this;
+    }
+
+    /// Iterators
+    iterator begin() { return m_data; }
+    const_iterator begin() const { return m_data; }
+    iterator end() { return m_data + m_size; }
+    const_iterator end() const { return m_data + m_size; }
+
+    /// Size
+    size_type size() const { return m_size; }
+    /// Is empty?
+    bool empty() const { return !m_size; }
+    /// Capacity
+    size_type capacity() const { return m_cap; }
+
+    /// Element access
+    T& operator[](size_type i) { return m_data[i]; }
+    const T& operator[](size_type i) const { return m_data[i]; }
+    T& front() { return m_data[0]; }
+    const T& front() const { return m_data[0]; }
+    T& back() { return m_data[m_size - 1]; }
+    const T& back() const { return m_data[m_size - 1]; }
+
+    /// Reserve space
+    void reserve(size_type n) { if (n > m_cap) grow(n); }
+
+    /// Add element at the end
+    void push_back(const T &x)
+    {
+        if (m_size == m_cap) {
+            // x may live in this vector
+            T tmp(x);
+            grow(2 * m_cap);
+            new (m_data + m_size) T(std::move(tmp));
+        } else {
+            new (m_data + m_size) T(x);
+        }
+        ++m_size;
+    }
+    /// Add element at the end (move)
+    void push_back(T &&x)
+    {
+        if (m_size == m_cap) {
+            T tmp(std::move(x));
+            grow(2 * m_cap);
+            new (m_data + m_size) T(std::move(tmp));
+        } else {
+            new (m_data + m_size) T(std::move(x));
+        }
+        ++m_size;
+    }
+    /// Remove last element
+    void pop_back() { m_data[--m_size].~T(); }
+
+    /// Insert element before pos
+    iterator insert(iterator pos, const T &x)
+    {
+        size_type i = pos - m_data;
+        push_back(x);
+        rotate_back(i, 1);
+        return m_data + i;
+    }
+    /// Insert range [first, last) before pos; the range must not point
+    /// into this vector.
+    template <typename It>
+    iterator insert(iterator pos, It first, It last)
+    {
+        size_type i = pos - m_data;
+        size_type n = std::distance(first, last);
+        if (!n) return pos;
+        if (m_size + n > m_cap) grow(std::max(m_size + n, 2 * m_cap));
+        for (T *p = m_data + m_size; first != last; ++first, ++p, ++m_size)
+            new (p) T(*first);
+        rotate_back(i, n);
+        return m_data + i;
+    }
+
+    /// Erase element
+    iterator erase(iterator pos) { return erase(pos, pos + 1); }
+    /// Erase range
+    iterator erase(iterator first, iterator last)
+    {
+        if (first == last) return first;
+        iterator o = first;
+        for (iterator i = last; i != end(); ++i, ++o) *o = std::move(*i);
+        for (iterator i = o; i != end(); ++i) i->~T();
+        m_size = o - m_data;
+        return first;
+    }
+    /// Remove all elements (capacity is kept)
+    void clear()
+    {
+        for (size_type i = 0; i < m_size; ++i) m_data[i].~T();
+        m_size = 0;
+    }
+
+  private:
+    typedef typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+
+    // Elements
+    T *m_data;
+    // Size and capacity
+    size_type m_size, m_cap;
+    // Inline storage
+    storage m_buf[N];
+
+    T* inl() { return reinterpret_cast<T*>(m_buf); }
+    bool is_inline() const { return m_data == reinterpret_cast<const T*>(m_buf); }
+
+    // Free heap storage
+    static void release(T *p, size_type n)
+    {
+        node_pools::get_instance().free(p, n * sizeof(T));
+    }
+
+    // Move storage to the heap
+    void grow(size_type n)
+    {
+        T *p = static_cast<T*>(node_pools::get_instance().alloc(n * sizeof(T)));
+        for (size_type i = 0; i < m_size; ++i) {
+            new (p + i) T(std::move(m_data[i]));
+            m_data[i].~T();
+        }
+        if (!is_inline()) release(m_data, m_cap);
+        m_data = p;
+        m_cap = n;
+    }
+
+    // Move last n elements to position i
+    void rotate_back(size_type i, size_type n)
+    {
+        if (i + n == m_size) return;
+        std::rotate(m_data + i, m_data + m_size - n, m_data + m_size);
+    }
+
+    // Take contents of v; this vector must be empty and inline
+    void steal(small_vec &v) noexcept
+    {
+        if (v.is_inline()) {
+            for (size_type i = 0; i < v.m_size; ++i) {
+                new (m_data + i) T(std::move(v.m_data[i]));
+                v.m_data[i].~T();
+            }
+            m_size = v.m_size;
+        } else {
+            m_data = v.m_data;
+            m_size = v.m_size;
+            m_cap = v.m_cap;
+            v.m_data = v.inl();
+            v.m_cap = N;
+        }
+        v.m_size = 0;
+    }
+
+}; /* class small_vec */
+
+
+} /* namespace internal */
+} /* namespace symbolic */
+
+#endif /* SYMBOLIC_SMALL_VEC_H */
@@ -14,6 +14,7 @@
 
 #include <stringhash.h>
 #include <error.h>
+#include <new>
 
 using namespace symbolic;
 using namespace symbolic::internal;
@@ -31,6 +32,22 @@ unsigned trans(char c)
     return 0;
 }
 
+// Bits used by counter in hash values
+const unsigned cnt_bits = 19;
+const unsigned cnt_mask = (1u << cnt_bits) - 1;
+
+// FNV-1a
+inline
+unsigned str_hash(const std::string &str)
+{
+    unsigned h = 2166136261u;
+    for (std::string::size_type i = 0; i < str.size(); ++i) {
+        h ^= (unsigned char) str[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
 } /* namespace */
 
 
@@ -39,34 +56,64 @@ stringhash::get_hash(const std::string &str)
 {
     if (!str.size()) return 0;
 
-    std::map<std::string, unsigned>::const_iterator it;
-    it = m_map2int.find(str);
-    if (it != m_map2int.end()) {
-        return it->second;
+    unsigned mask = m_table.size() - 1;
+    unsigned s = str_hash(str) & mask;
+    while (m_table[s]) {
+        unsigned pos = m_table[s] - 1;
+        if (m_strs[pos] == str) return m_ids[pos];
+        s = (s + 1) & mask;
     }
 
-    if (m_ind >= 524288) {
+    unsigned pref = (trans(str[0]) << 6) + trans(str[1]);
+    std::vector<unsigned> &pv = m_prefix[pref];
+    if (pv.size() >= cnt_mask) {
         throw std::bad_alloc();
     }
 
-    unsigned ids = (trans(str[0]) << 25) + (trans(str[1]) << 19);
-    ids += (++m_ind);
-    m_map2int[str] = ids;
-    m_map2str[ids] = str;
+    unsigned pos = m_strs.size();
+    unsigned ids = (pref << cnt_bits) + pv.size() + 1;
+    pv.push_back(pos);
+    m_strs.push_back(str);
+    m_ids.push_back(ids);
+    m_underscore.push_back(false);
+    m_table[s] = pos + 1;
+    if (2 * m_strs.size() > m_table.size()) rehash();
 
     return ids;
 }
 
 
+void
+stringhash::rehash()
+{
+    std::vector<unsigned> table(2 * m_table.size(), 0);
+    unsigned mask = table.size() - 1;
+    for (unsigned pos = 0; pos < m_strs.size(); ++pos) {
+        unsigned s = str_hash(m_strs[pos]) & mask;
+        while (table[s]) s = (s + 1) & mask;
+        table[s] = pos + 1;
+    }
+    m_table.swap(table);
+}
+
+
+int
+stringhash::find_id(unsigned id) const
+{
+    unsigned pref = id >> cnt_bits, cnt = id & cnt_mask;
+    if ((pref >= m_prefix.size()) || !cnt || (cnt > m_prefix[pref].size())) return -1;
+    return m_prefix[pref][cnt - 1];
+}
+
+
 const std::string&
 stringhash::get_str(unsigned id) const
 {
-    static const std::string nul(""), quest("?");
+    static const std::string nul("");
     if (id == 0) return nul;
-    std::map<unsigned, std::string>::const_iterator it;
-    it = m_map2str.find(id);
-    if (it == m_map2str.end()) INTERNAL_ERROR
-    return it->second;
+    int pos = find_id(id);
+    if (pos < 0) INTERNAL_ERROR
+    return m_strs[pos];
 }
 
 
@@ -75,7 +122,7 @@ unsigned
 stringhash::append_underscore(unsigned id)
 {
     unsigned idn = get_hash(get_str(id) + '_');
-    m_underscore.insert(idn);
+    m_underscore[find_id(idn)] = true;
     return idn;
 }
 
@@ -92,20 +139,7 @@ stringhash::append(unsigned id, const std::string &s)
 bool
 stringhash::has_underscore(unsigned id) const
 {
-    std::set<unsigned>::const_iterator it;
-    it = m_underscore.find(id);
-    if (it != m_underscore.end()) return true;
-    return false;
+    int pos = find_id(id);
+    if (pos < 0) return false;
+    return m_underscore[pos];
 }
-
-
-
-
-
-
-
-
-
-
-
-
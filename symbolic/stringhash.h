@@ -17,14 +17,18 @@
 #define SYMBOLIC_STRINGHASH_H
 
 #include <string>
-#include <map>
-#include <set>
+#include <vector>
 
 
 namespace symbolic {
 namespace internal {
 
-/// Singleton class handling hash values for strings
+/// Singleton class handling hash values for strings.
+/// Strings are interned in an open addressing table. Hash value of
+/// a string consists of codes of its first two characters followed by
+/// a counter running separately for every pair of first characters,
+/// so that comparing hash values orders strings by first characters
+/// and then by the order in which they were interned.
 class stringhash
 {
   public:
@@ -38,6 +42,8 @@ class stringhash
     unsigned append(unsigned id, const std::string &s);
     /// Given string hash value return hash value of a string with appended underscore.
     bool has_underscore(unsigned id) const;
+    /// Number of interned strings
+    unsigned size() const { return m_strs.size(); }
     /// Get instance
     static stringhash& get_instance()
     {
@@ -46,15 +52,20 @@ class stringhash
     }
 
   private:
-    // Maps
-    std::map<std::string, unsigned> m_map2int;
-    std::map<unsigned, std::string> m_map2str;
-    // Strings with underscores at the end (used internally).
-    std::set<unsigned> m_underscore;
-    // Index
-    unsigned m_ind;
+    // Interned strings, hash values and underscore flags (indexed by position)
+    std::vector<std::string> m_strs;
+    std::vector<unsigned> m_ids;
+    std::vector<bool> m_underscore;
+    // Open addressing table (position + 1, 0 means empty slot)
+    std::vector<unsigned> m_table;
+    // Positions of strings for every pair of first characters
+    std::vector<std::vector<unsigned> > m_prefix;
+    // Position of string with given hash value (-1 if not found)
+    int find_id(unsigned id) const;
+    // Double the size of the table
+    void rehash();
     // Constructor is private
-    stringhash() : m_ind(0) { ; }
+    stringhash() : m_table(1024, 0), m_prefix(1 << 12) { ; }
     // Private, too. Not implemented.
     stringhash(stringhash const& copy);
     stringhash& operator=(stringhash const& copy);
@@ -0,0 +1,41 @@
+/*****************************************************************************
+ * This file is a part of gEcon.                                             *
+ *                                                                           *
+ * (c) Chancellery of the Prime Minister of the Republic of Poland 2012-2015 *
+ * (c) Grzegorz Klima, Karol Podemski, Kaja Retkiewicz-Wijtiwiak 2015-2016   *
+ * License terms can be found in the file 'LICENCE'                          *
+ *                                                                           *
+ * Author: Grzegorz Klima                                                    *
+ *****************************************************************************/
+
+/** \file trans_cache.cpp
+ * \brief Memo table for time shifts and steady state transformations.
+ */
+
+
+#include <trans_cache.h>
+
+
+using namespace symbolic;
+using namespace symbolic::internal;
+
+
+namespace {
+
+// Transformations have no node argument
+const ptr_base no_arg(0);
+
+} /* namespace */
+
+
+
+ptr_base
+trans_cache::get(const ptr_base &e, trans_code c, int arg, trans_fn f)
+{
+    const ptr_base *r = m_tab.find(e, c, no_arg, arg);
+    if (r) return *r;
+    // Transformation recurses into the cache, entry is stored afterwards
+    ptr_base res = f(e, arg);
+    m_tab.insert(e, c, no_arg, arg, res);
+    return res;
+}
@@ -0,0 +1,83 @@
+/*****************************************************************************
+ * This file is a part of gEcon.                                             *
+ *                                                                           *
+ * (c) Chancellery of the Prime Minister of the Republic of Poland 2012-2015 *
+ * (c) Grzegorz Klima, Karol Podemski, Kaja Retkiewicz-Wijtiwiak 2015-2016   *
+ * License terms can be found in the file 'LICENCE'                          *
+ *                                                                           *
+ * Author: Grzegorz Klima                                                    *
+ *****************************************************************************/
+
+/** \file trans_cache.h
+ * \brief Memo table for time shifts and steady state transformations.
+ */
+
+#ifndef SYMBOLIC_TRANS_CACHE_H
+
+#define SYMBOLIC_TRANS_CACHE_H
+
+#include <decl.h>
+#include <ptr_base.h>
+#include <memo_table.h>
+#include <string>
+
+
+namespace symbolic {
+namespace internal {
+
+
+/// Transformations memoized in trans_cache
+enum trans_code {
+    /// lag(e, arg)
+    TRANS_LAG = 1,
+    /// lag0(e)
+    TRANS_LAG0,
+    /// ss(e)
+    TRANS_SS,
+    /// drop_Es(e)
+    TRANS_DROP_ES
+};
+
+/// Transformation of compound expression (not looked up in the cache).
+typedef ptr_base (*trans_fn)(const ptr_base &e, int arg);
+
+
+/// Singleton class memoizing transformations (lag, lag0, ss, drop_Es)
+/// of compound expressions (entries are keyed by the expression,
+/// transformation code and its argument, see memo_table).
+class trans_cache
+{
+  public:
+    /// Transformation c with argument arg of e (f(e, arg), looked up in
+    /// the cache).
+    ptr_base get(const ptr_base &e, trans_code c, int arg, trans_fn f);
+    /// Drop all entries and reset statistics.
+    void clear() { m_tab.clear(); }
+    /// Number of entries
+    unsigned size() const { return m_tab.size(); }
+    /// Cache statistics (empty if cache was not used)
+    std::string stats() const { return m_tab.stats(); }
+    /// Get instance
+    static trans_cache& get_instance()
+    {
+        // Never destroyed, like the unique table
+        static trans_cache *instance = new trans_cache;
+        return *instance;
+    }
+
+  private:
+    // Memo table
+    memo_table m_tab;
+    // Constructor is private
+    trans_cache() { ; }
+    // Private, too. Not implemented.
+    trans_cache(trans_cache const& copy);
+    trans_cache& operator=(trans_cache const& copy);
+
+}; /* class trans_cache */
+
+
+} /* namespace internal */
+} /* namespace symbolic */
+
+#endif /* SYMBOLIC_TRANS_CACHE_H */
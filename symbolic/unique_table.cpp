@@ -0,0 +1,181 @@
+/*****************************************************************************
+ * This file is a part of gEcon.                                             *
+ *                                                                           *
+ * (c) Chancellery of the Prime Minister of the Republic of Poland 2012-2015 *
+ * (c) Grzegorz Klima, Karol Podemski, Kaja Retkiewicz-Wijtiwiak 2015-2016   *
+ * License terms can be found in the file 'LICENCE'                          *
+ *                                                                           *
+ * Author: Grzegorz Klima                                                    *
+ *****************************************************************************/
+
+/** \file unique_table.cpp
+ * \brief Table of unique (hash-consed) expression nodes.
+ */
+
+#include <unique_table.h>
+#include <ex_num.h>
+#include <ex_delta.h>
+#include <ex_symb.h>
+#include <ex_symbidx.h>
+#include <ex_vart.h>
+#include <ex_vartidx.h>
+#include <ex_add.h>
+#include <ex_mul.h>
+#include <ex_pow.h>
+#include <ex_func.h>
+#include <ex_e.h>
+#include <ex_sum.h>
+#include <ex_prod.h>
+#include <ex_idx.h>
+#include <error.h>
+
+
+using namespace symbolic::internal;
+
+
+namespace {
+
+#ifdef EXPAND_CASE
+#undef EXPAND_CASE
+#endif
+#define EXPAND_CASES \
+    EXPAND_CASE(NUM, ex_num) \
+    EXPAND_CASE(DELTA, ex_delta) \
+    EXPAND_CASE(SYMB, ex_symb) \
+    EXPAND_CASE(SYMBIDX, ex_symbidx) \
+    EXPAND_CASE(VART, ex_vart) \
+    EXPAND_CASE(VARTIDX, ex_vartidx) \
+    EXPAND_CASE(EX, ex_e) \
+    EXPAND_CASE(POW, ex_pow) \
+    EXPAND_CASE(FUN, ex_func) \
+    EXPAND_CASE(ADD, ex_add) \
+    EXPAND_CASE(MUL, ex_mul) \
+    EXPAND_CASE(SUM, ex_sum) \
+    EXPAND_CASE(PROD, ex_prod) \
+    EXPAND_CASE(IDX, ex_idx)
+
+
+bool
+identical(const ex_base *a, const ex_base *b)
+{
+    if (a->type() != b->type()) return false;
+    if (a->flag() != b->flag()) return false;
+#define EXPAND_CASE(TYPE, CLASS) \
+        case TYPE: \
+            return static_cast<const CLASS*>(a)->identical(*static_cast<const CLASS*>(b));
+    switch (a->type()) {
+        EXPAND_CASES
+        default:
+            INTERNAL_ERROR
+    }
+#undef EXPAND_CASE
+}
+
+
+void
+destroy_node(ex_base *p)
+{
+#define EXPAND_CASE(TYPE, CLASS) \
+        case TYPE: \
+            CLASS::destroy(p); \
+            break;
+    switch (p->type()) {
+        EXPAND_CASES
+        default:
+            INTERNAL_ERROR
+    }
+#undef EXPAND_CASE
+}
+
+#undef EXPAND_CASES
+
+const unsigned initial_size = 1024;
+
+} /* namespace */
+
+
+
+unique_table::unique_table() : m_size(0)
+{
+    entry e = { 0, 0 };
+    m_tab.assign(initial_size, e);
+}
+
+
+
+ptr_base
+unique_table::intern(ex_base *p)
+{
+    unsigned h = p->hash();
+    unsigned mask = m_tab.size() - 1;
+    unsigned i = h & mask;
+    for (; m_tab[i].p; i = (i + 1) & mask) {
+        if ((m_tab[i].h == h) && identical(m_tab[i].p, p)) {
+            ptr_base res(m_tab[i].p);
+            destroy_node(p);
+            return res;
+        }
+    }
+
+    m_tab[i].p = p;
+    m_tab[i].h = h;
+    if (4 * ++m_size > 3 * m_tab.size()) rehash();
+    return ptr_base(p);
+}
+
+
+
+void
+unique_table::erase(const ex_base *p)
+{
+    unsigned mask = m_tab.size() - 1;
+    unsigned i = p->hash() & mask;
+    for (; m_tab[i].p != p; i = (i + 1) & mask) {
+        if (!m_tab[i].p) return;
+    }
+    --m_size;
+    // Backward shift deletion
+    unsigned j = i;
+    for (;;) {
+        m_tab[i].p = 0;
+        for (;;) {
+            j = (j + 1) & mask;
+            if (!m_tab[j].p) return;
+            unsigned k = m_tab[j].h & mask;
+            if ((i <= j) ? ((i < k) && (k <= j)) : ((i < k) || (k <= j))) continue;
+            break;
+        }
+        m_tab[i] = m_tab[j];
+        i = j;
+    }
+}
+
+
+
+void
+unique_table::clear()
+{
+    std::vector<entry> tab;
+    entry e = { 0, 0 };
+    tab.assign(initial_size, e);
+    m_tab.swap(tab);
+    m_size = 0;
+}
+
+
+
+void
+unique_table::rehash()
+{
+    std::vector<entry> old;
+    old.swap(m_tab);
+    entry e = { 0, 0 };
+    m_tab.assign(2 * old.size(), e);
+    unsigned mask = m_tab.size() - 1;
+    for (std::vector<entry>::const_iterator it = old.begin(); it != old.end(); ++it) {
+        if (!it->p) continue;
+        unsigned i = it->h & mask;
+        while (m_tab[i].p) i = (i + 1) & mask;
+        m_tab[i] = *it;
+    }
+}
@@ -0,0 +1,112 @@
+/*****************************************************************************
+ * This file is a part of gEcon.                                             *
+ *                                                                           *
+ * (c) Chancellery of the Prime Minister of the Republic of Poland 2012-2015 *
+ * (c) Grzegorz Klima, Karol Podemski, Kaja Retkiewicz-Wijtiwiak 2015-2016   *
+ * License terms can be found in the file 'LICENCE'                          *
+ *                                                                           *
+ * Author: Grzegorz Klima                                                    *
+ *****************************************************************************/
+
+/** \file unique_table.h
+ * \brief Table of unique (hash-consed) expression nodes.
+ */
+
+#ifndef SYMBOLIC_UNIQUE_TABLE_H
+
+#define SYMBOLIC_UNIQUE_TABLE_H
+
+#include <decl.h>
+#include <number.h>
+#include <ptr_base.h>
+#include <vector>
+#include <cstring>
+
+
+namespace symbolic {
+namespace internal {
+
+
+/// Combine hash values
+inline
+unsigned
+hash_mix(unsigned h, unsigned v)
+{
+    return h ^ (v + 0x9e3779b9u + (h << 6) + (h >> 2));
+}
+
+/// Hash value of a Number (consistent with Number comparison)
+inline
+unsigned
+hash_num(const Number &n)
+{
+    double d = n.val();
+    if (d == 0.) return 0;
+    if (d != d) return 0x7ff80000u;
+    unsigned w[sizeof(double) / sizeof(unsigned)];
+    std::memcpy(w, &d, sizeof(double));
+    unsigned h = 0;
+    for (unsigned i = 0; i < sizeof(double) / sizeof(unsigned); ++i) h = hash_mix(h, w[i]);
+    return h;
+}
+
+/// Are Numbers identical (bitwise)?
+inline
+bool
+identical_num(const Number &a, const Number &b)
+{
+    double da = a.val(), db = b.val();
+    return !std::memcmp(&da, &db, sizeof(double));
+}
+
+
+/// Singleton class holding unique (hash-consed) expression nodes.
+/// All nodes are created through the unique table, so that structurally
+/// identical expressions share a single node. Nodes are keyed by their
+/// structural hash and removed from the table when their last reference
+/// is dropped.
+class unique_table
+{
+  public:
+    /// Given newly allocated node return pointer to the unique identical node;
+    /// if such node already exists p is freed.
+    ptr_base intern(ex_base *p);
+    /// Remove node from the table (called when the last reference is dropped).
+    void erase(const ex_base *p);
+    /// Remove all nodes (nodes are not visited, see node_pools::drop).
+    void clear();
+    /// Number of nodes in the table
+    unsigned size() const { return m_size; }
+    /// Get instance
+    static unique_table& get_instance()
+    {
+        // Never destroyed, nodes held by static objects may outlive it
+        static unique_table *instance = new unique_table;
+        return *instance;
+    }
+
+  private:
+    // Table entry
+    struct entry {
+        ex_base *p;
+        unsigned h;
+    };
+    // Open addressing table (size is a power of 2)
+    std::vector<entry> m_tab;
+    // Number of entries
+    unsigned m_size;
+    // Constructor is private
+    unique_table();
+    // Private, too. Not implemented.
+    unique_table(unique_table const& copy);
+    unique_table& operator=(unique_table const& copy);
+    // Grow table
+    void rehash();
+
+}; /* class unique_table */
+
+
+} /* namespace internal */
+} /* namespace symbolic */
+
+#endif /* SYMBOLIC_UNIQUE_TABLE_H */